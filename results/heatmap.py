@@ -0,0 +1,120 @@
+import argparse
+import json
+from multiprocessing import Pool
+from pathlib import Path
+from typing import Any, Dict, List, Tuple
+
+from run import update_overview
+
+SATURATED_LOAD = 0.95
+
+def read_transcript(transcript_file: Path) -> Tuple[int, int, List[List[Tuple[float, int]]]]:
+    """Returns resourceN, week and per interaction the (load, number of let operations) of every resource-week."""
+    lines = transcript_file.read_text(encoding="utf-8").splitlines()
+
+    week, resource_n, _, reactive_n = map(int, lines[0].split(" "))
+    index = 1 + resource_n * 9
+
+    interactions = []
+    while index + resource_n + 1 + resource_n * week <= len(lines):
+        index += resource_n + 1
+
+        loads = []
+        for line in lines[index:index + resource_n * week]:
+            load, let_count = line.split(" ")
+            loads.append((float(load), int(let_count)))
+
+        interactions.append(loads)
+        index += resource_n * week
+
+    return resource_n, week, interactions
+
+def analyze_seed(transcript_file: Path) -> Dict[str, Any]:
+    resource_n, week, interactions = read_transcript(transcript_file)
+
+    cells = resource_n * week
+    load_sum = [0.0] * cells
+    saturated = [0] * cells
+    late = [0] * cells
+
+    for loads in interactions:
+        for i, (load, let_count) in enumerate(loads):
+            load_sum[i] += load
+            saturated[i] += 1 if load > SATURATED_LOAD else 0
+            late[i] += 1 if let_count > 0 else 0
+
+    interaction_n = max(1, len(interactions))
+
+    return {
+        "resourceN": resource_n,
+        "week": week,
+        "interactions": len(interactions),
+        "load": [round(value / interaction_n, 3) for value in load_sum],
+        "saturated": [round(value / interaction_n, 3) for value in saturated],
+        "late": [round(value / interaction_n, 3) for value in late]
+    }
+
+def aggregate(seeds: Dict[str, Dict[str, Any]]) -> Dict[str, Any]:
+    """Aggregates the seeds of one solver, weeks are bucketed by their relative position in the horizon."""
+    buckets = 10
+    cells = 0
+    saturated = 0.0
+    late = 0.0
+    saturated_by_position = [0.0] * buckets
+    late_by_position = [0.0] * buckets
+    cells_by_position = [0] * buckets
+
+    for heatmap in seeds.values():
+        for i in range(heatmap["resourceN"] * heatmap["week"]):
+            position = (i % heatmap["week"]) * buckets // heatmap["week"]
+
+            cells += 1
+            saturated += heatmap["saturated"][i]
+            late += heatmap["late"][i]
+            cells_by_position[position] += 1
+            saturated_by_position[position] += heatmap["saturated"][i]
+            late_by_position[position] += heatmap["late"][i]
+
+    return {
+        "seeds": len(seeds),
+        "saturated": round(saturated / max(1, cells), 4),
+        "late": round(late / max(1, cells), 4),
+        "saturatedByPosition": [round(saturated_by_position[i] / max(1, cells_by_position[i]), 4) for i in range(buckets)],
+        "lateByPosition": [round(late_by_position[i] / max(1, cells_by_position[i]), 4) for i in range(buckets)]
+    }
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description="Build resource-week bottleneck heatmaps from judge transcripts.")
+    parser.add_argument("solvers", type=str, nargs="*", help="the solvers to analyze (defaults to all)")
+
+    args = parser.parse_args()
+
+    outputs_root = Path(__file__).parent / "output"
+    heatmaps_file = Path(__file__).parent / "heatmaps.json"
+
+    heatmaps = json.loads(heatmaps_file.read_text(encoding="utf-8")) if heatmaps_file.is_file() else {}
+
+    solvers = args.solvers if len(args.solvers) > 0 else sorted(directory.name for directory in outputs_root.iterdir())
+    for solver in solvers:
+        transcript_files = sorted((outputs_root / solver).glob("*.transcript"))
+        if len(transcript_files) == 0:
+            print(f"{solver}: no transcripts, run run.py with --transcripts first")
+            continue
+
+        with Pool() as pool:
+            results = pool.map(analyze_seed, transcript_files)
+
+        seeds = {file.stem: result for file, result in zip(transcript_files, results)}
+        summary = aggregate(seeds)
+        heatmaps[solver] = {"seeds": seeds, "aggregate": summary}
+
+        print(f"{solver}: {summary['saturated']:.2%} of resource-weeks saturated (load > {SATURATED_LOAD}), "
+              f"{summary['late']:.2%} with late operations ({summary['seeds']} seeds)")
+
+    with heatmaps_file.open("w+", encoding="utf-8") as file:
+        json.dump(heatmaps, file, separators=(",", ":"))
+
+    update_overview()
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,284 @@
+import argparse
+import json
+import os
+import socket
+import threading
+import time
+from multiprocessing import Process
+from pathlib import Path
+from typing import Any, Dict, List, Optional, Tuple
+
+from run import get_cpu_slots, get_usage_from_logs, run_seed, update_overview
+from store import ResultsStore, get_default_store_file
+
+# Job queue on a shared directory, for running sweeps with workers on several hosts.
+#
+#   pending/<solver>-<seed>.json             jobs waiting for a worker
+#   running/<worker>--<solver>-<seed>.json   claimed jobs
+#   running/<worker>--<solver>-<seed>.beat   the worker's heartbeat counter for the claimed job
+#   done/<solver>-<seed>.json                result rows, moved into the results store by collect
+#   failed/<solver>-<seed>.json              jobs that failed or went stale too often
+#   output/<solver>/                         judge output and logs
+#
+# A job is claimed by renaming it from pending/ to running/, which succeeds for exactly one worker. Jobs in running/
+# whose heartbeat a process has not seen change for the stale timeout, measured on its own clock, are renamed back to
+# pending/ by whichever process notices first. The worker only ever writes its beat file, so a heartbeat can never bring
+# back a running file that was requeued meanwhile. Clocks of different hosts and file times on the shared filesystem are
+# never compared. A job whose run raises is requeued the same way, by its worker if it still owns the running file. The directory has to be on one filesystem so the
+# renames are atomic, NFS and similar shared filesystems provide that. Solvers are looked up in the worker's own
+# cmake-build-release directory.
+
+HEARTBEAT_INTERVAL = 5.0
+STALE_TIMEOUT = 60.0
+POLL_INTERVAL = 1.0
+MAX_ATTEMPTS = 3
+
+def get_job_name(solver: str, seed: int) -> str:
+    return f"{solver}-{seed}.json"
+
+def write_json(file: Path, content: Dict[str, Any]) -> None:
+    # written next to the target and renamed, so other hosts never see a partial file
+    temporary_file = file.with_name(f".{file.name}.{socket.gethostname()}.{os.getpid()}.tmp")
+    temporary_file.write_text(json.dumps(content), encoding="utf-8")
+    temporary_file.replace(file)
+
+def create_directories(queue_directory: Path) -> None:
+    for name in ["pending", "running", "done", "failed", "output"]:
+        (queue_directory / name).mkdir(parents=True, exist_ok=True)
+
+def enqueue(queue_directory: Path, solver: str, seeds: List[int]) -> None:
+    create_directories(queue_directory)
+
+    for seed in seeds:
+        write_json(queue_directory / "pending" / get_job_name(solver, seed),
+                   {"solver": solver, "seed": seed, "attempts": 0})
+
+    print(f"Enqueued {len(seeds)} jobs for {solver}")
+
+def get_beat_file(running_file: Path) -> Path:
+    return running_file.with_suffix(".beat")
+
+def move_job(queue_directory: Path, job: Dict[str, Any]) -> str:
+    """Counts a failed attempt and writes the job back to pending/, or to failed/ after MAX_ATTEMPTS."""
+    job["attempts"] += 1
+
+    target = "pending" if job["attempts"] < MAX_ATTEMPTS else "failed"
+    write_json(queue_directory / target / get_job_name(job["solver"], job["seed"]), job)
+    return target
+
+def requeue_stale_jobs(queue_directory: Path, stale_timeout: float, heartbeats: Dict[str, Tuple[int, float]]) -> None:
+    """heartbeats keeps the last heartbeat seen per running file and the local time it was first seen."""
+    now = time.monotonic()
+    files = list((queue_directory / "running").glob("*.json"))
+    for name in set(heartbeats) - {file.name for file in files}:
+        del heartbeats[name]
+
+    # beat files whose job is gone, written by a heartbeat that raced with the requeue
+    for beat_file in (queue_directory / "running").glob("*.beat"):
+        if not beat_file.with_suffix(".json").exists():
+            beat_file.unlink(missing_ok=True)
+
+    for file in files:
+        try:
+            try:
+                beat = json.loads(get_beat_file(file).read_text(encoding="utf-8"))["heartbeat"]
+            except FileNotFoundError:
+                beat = 0
+            if heartbeats.get(file.name, (None, 0.0))[0] != beat:
+                heartbeats[file.name] = (beat, now)
+            if now - heartbeats[file.name][1] < stale_timeout:
+                continue
+
+            # claim the stale job first, so only one process requeues it
+            requeued_file = file.with_name(f".{file.name}.requeue")
+            file.rename(requeued_file)
+        except FileNotFoundError:
+            continue
+
+        job = json.loads(requeued_file.read_text(encoding="utf-8"))
+        target = move_job(queue_directory, job)
+        requeued_file.unlink()
+        get_beat_file(file).unlink(missing_ok=True)
+        del heartbeats[file.name]
+
+        print(f"Requeued stale job {file.name} to {target}/")
+
+def claim_job(queue_directory: Path, worker_id: str) -> Optional[Path]:
+    for file in sorted((queue_directory / "pending").glob("*.json")):
+        running_file = queue_directory / "running" / f"{worker_id}--{file.name}"
+        try:
+            file.rename(running_file)
+        except FileNotFoundError:
+            # claimed by another worker
+            continue
+
+        return running_file
+
+    return None
+
+def heartbeat(running_file: Path, stop: threading.Event) -> None:
+    beat = 0
+    while not stop.wait(HEARTBEAT_INTERVAL):
+        if not running_file.exists():
+            # requeued by someone else, the result of this run is still valid
+            return
+
+        beat += 1
+        write_json(get_beat_file(running_file), {"heartbeat": beat})
+
+def run_job(queue_directory: Path, running_file: Path) -> None:
+    job = json.loads(running_file.read_text(encoding="utf-8"))
+    solver, seed = job["solver"], job["seed"]
+
+    solver_file = Path(__file__).parent.parent / "cmake-build-release" / f"solver_{solver}"
+    output_directory = queue_directory / "output" / solver
+    output_directory.mkdir(parents=True, exist_ok=True)
+
+    stop = threading.Event()
+    heartbeat_thread = threading.Thread(target=heartbeat, args=(running_file, stop), daemon=True)
+    heartbeat_thread.start()
+
+    try:
+        if not solver_file.is_file():
+            raise RuntimeError(f"Solver not found, {solver_file} is not a file")
+
+        score, wall_time = run_seed(solver_file, seed, output_directory)
+        usage = get_usage_from_logs(output_directory / f"{seed}.log")
+    except Exception as error:
+        # any failure is an attempt, the job is never dropped with its running file
+        stop.set()
+        heartbeat_thread.join()
+
+        job["error"] = f"{type(error).__name__}: {error}"
+        requeued_file = running_file.with_name(f".{running_file.name}.requeue")
+        try:
+            running_file.rename(requeued_file)
+        except FileNotFoundError:
+            print(f"{solver} {seed}: {job['error']}, already requeued as stale")
+            return
+
+        target = move_job(queue_directory, job)
+        requeued_file.unlink()
+        get_beat_file(running_file).unlink(missing_ok=True)
+        print(f"{solver} {seed}: {job['error']}, moved to {target}/")
+        return
+
+    stop.set()
+    heartbeat_thread.join()
+
+    # if writing the result fails, the running file stays and the job goes stale
+    write_json(queue_directory / "done" / get_job_name(solver, seed), {
+        "seed": seed,
+        "solver": solver,
+        "score": score,
+        "wall_time": wall_time,
+        "solver_cpu_ms": usage.get("solver_user_ms", 0.0) + usage.get("solver_sys_ms", 0.0),
+        "solver_max_rss_kb": usage.get("solver_max_rss_kb", 0.0),
+        "timestamp": time.time(),
+        "metadata": json.dumps({"host": socket.gethostname(), "attempts": job["attempts"] + 1})
+    })
+    running_file.unlink(missing_ok=True)
+    get_beat_file(running_file).unlink(missing_ok=True)
+
+def work(queue_directory: Path, stale_timeout: float, slot: Optional[List[int]]) -> None:
+    if slot is not None:
+        os.sched_setaffinity(0, slot)
+
+    worker_id = f"{socket.gethostname()}-{os.getpid()}"
+    completed = 0
+    heartbeats: Dict[str, Tuple[int, float]] = {}
+
+    while True:
+        requeue_stale_jobs(queue_directory, stale_timeout, heartbeats)
+
+        running_file = claim_job(queue_directory, worker_id)
+        if running_file is not None:
+            run_job(queue_directory, running_file)
+            completed += 1
+            continue
+
+        # stay around while other workers still run jobs, they may go stale and come back to pending
+        if not any((queue_directory / "running").glob("*.json")):
+            break
+
+        time.sleep(POLL_INTERVAL)
+
+    print(f"Worker {worker_id} finished {completed} jobs")
+
+def start_workers(queue_directory: Path, processes: int, pin: bool, stale_timeout: float) -> None:
+    create_directories(queue_directory)
+
+    slots: List[Optional[List[int]]] = [None] * processes
+    if pin:
+        cpu_slots = get_cpu_slots()
+        processes = min(processes, len(cpu_slots))
+        slots = cpu_slots[:processes]
+
+    workers = [Process(target=work, args=(queue_directory, stale_timeout, slots[i])) for i in range(processes)]
+    for worker in workers:
+        worker.start()
+    for worker in workers:
+        worker.join()
+
+def collect(queue_directory: Path) -> None:
+    """Moves the finished jobs into the local results store."""
+    done_files = sorted((queue_directory / "done").glob("*.json"))
+    rows = [json.loads(file.read_text(encoding="utf-8")) for file in done_files]
+
+    ResultsStore(get_default_store_file()).append(rows)
+    for file in done_files:
+        file.unlink()
+
+    print(f"Collected {len(rows)} results")
+    update_overview()
+
+def print_status(queue_directory: Path) -> None:
+    for name in ["pending", "running", "done", "failed"]:
+        files = list((queue_directory / name).glob("*.json"))
+        print(f"{name}: {len(files)}")
+
+        if name == "failed":
+            for file in files:
+                job = json.loads(file.read_text(encoding="utf-8"))
+                print(f"  {job['solver']} {job['seed']}: {job.get('error', 'stale')}")
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description="Run benchmarks through a job queue on a shared directory.")
+    parser.add_argument("directory", type=str, help="the queue directory")
+    subparsers = parser.add_subparsers(dest="command", required=True)
+
+    enqueue_parser = subparsers.add_parser("enqueue", help="add (solver, seed) jobs")
+    enqueue_parser.add_argument("solvers", type=str, nargs="+", help="the solvers to run")
+    enqueue_parser.add_argument("--seeds", type=str, default="1-100", help="seed range, e.g. 1-1000")
+    enqueue_parser.add_argument("--seeds-file", type=str, help="file with the seeds to run, one per line")
+
+    worker_parser = subparsers.add_parser("worker", help="run jobs until the queue is empty")
+    worker_parser.add_argument("--processes", type=int, default=os.cpu_count(), help="number of worker processes")
+    worker_parser.add_argument("--pin", action="store_true", help="pin every worker to its own physical core(s)")
+    worker_parser.add_argument("--stale-timeout", type=float, default=STALE_TIMEOUT,
+                               help="seconds without a new heartbeat after which a running job is requeued")
+
+    subparsers.add_parser("collect", help="move finished jobs into the results store")
+    subparsers.add_parser("status", help="show the number of jobs per state")
+
+    args = parser.parse_args()
+    queue_directory = Path(args.directory)
+
+    if args.command == "enqueue":
+        if args.seeds_file is not None:
+            seeds = [int(line) for line in Path(args.seeds_file).read_text(encoding="utf-8").split()]
+        else:
+            first, last = map(int, args.seeds.split("-"))
+            seeds = list(range(first, last + 1))
+
+        for solver in args.solvers:
+            enqueue(queue_directory, solver, seeds)
+    elif args.command == "worker":
+        start_workers(queue_directory, args.processes, args.pin, args.stale_timeout)
+    elif args.command == "collect":
+        collect(queue_directory)
+    else:
+        print_status(queue_directory)
+
+if __name__ == "__main__":
+    main()
@@ -1,10 +1,15 @@
 import argparse
 import json
+import os
 import shutil
 import subprocess
+import time
 from pathlib import Path
-from multiprocessing import Pool
-from typing import List
+from multiprocessing import Pool, Queue
+from statistics import mean, median, stdev
+from typing import Dict, List, Optional, Tuple
+
+from store import ResultsStore, get_default_store_file
 
 def get_score_from_logs(logs_file: Path) -> int:
     logs_content = logs_file.read_text(encoding="utf-8")
@@ -14,79 +19,311 @@ def get_score_from_logs(logs_file: Path) -> int:
 
     return 0
 
-def update_overview() -> None:
-    scores_by_solver = {}
+def get_usage_from_logs(logs_file: Path) -> Dict[str, float]:
+    """Returns the judge's "Usage = key=value ..." line as a dict, empty if the judge did not print one."""
+    logs_content = logs_file.read_text(encoding="utf-8")
+    for line in reversed(logs_content.splitlines()):
+        if line.startswith("Usage = "):
+            return {key: float(value) for key, value in (pair.split("=") for pair in line[8:].split(" "))}
+
+    return {}
+
+def print_usage(output_directory: Path, seeds: List[int]) -> None:
+    usages = [get_usage_from_logs(output_directory / f"{seed}.log") for seed in seeds]
+    usages = [usage for usage in usages if len(usage) > 0]
+    if len(usages) == 0:
+        return
+
+    cpu = [usage["solver_user_ms"] + usage["solver_sys_ms"] for usage in usages]
+    max_rss = max(usage["solver_max_rss_kb"] for usage in usages)
+    switches = mean(usage["solver_voluntary_switches"] + usage["solver_involuntary_switches"] for usage in usages)
+
+    print(f"Solver CPU: mean {mean(cpu):,.0f} ms, max {max(cpu):,.0f} ms, "
+          f"max RSS {max_rss / 1024:,.1f} MiB, mean context switches {switches:,.0f}")
+
+def get_convergence_from_metrics(metrics_file: Path) -> Optional[Tuple[int, float, Optional[int]]]:
+    """Returns the seed's reactiveN, normalized area under its best-score curve and interactions to reach 99% of final.
+
+    Returns None if the metrics file is missing, empty or cut off, e.g. after a crashed judge.
+    """
+    if not metrics_file.is_file():
+        return None
+
+    content = metrics_file.read_text(encoding="utf-8")
+    if not content.endswith("\n"):
+        # the judge writes whole lines, a missing newline means it stopped while writing
+        return None
+
+    lines = content.splitlines()
+    try:
+        reactive_n = int(lines[0].split(" ")[2])
+
+        best_scores = []
+        for line in lines[1:]:
+            score = int(line.split(" ")[1])
+            best_scores.append(max(score, best_scores[-1]) if len(best_scores) > 0 else score)
+    except (IndexError, ValueError):
+        return None
+
+    final_score = best_scores[-1] if len(best_scores) > 0 else 0
+    if final_score <= 0:
+        return reactive_n, 0.0, None
+
+    auc = sum(score / final_score for score in best_scores) / reactive_n
+    to_99 = next(i + 1 for i, score in enumerate(best_scores) if score >= 0.99 * final_score)
+
+    return reactive_n, auc, to_99
+
+def print_convergence(output_directory: Path, seeds: List[int]) -> None:
+    convergence_by_bucket: Dict[int, List[Tuple[float, Optional[int]]]] = {}
+
+    for seed in seeds:
+        metrics_file = output_directory / f"{seed}.metrics"
+        convergence = get_convergence_from_metrics(metrics_file)
+        if convergence is None:
+            print(f"Warning: skipping seed {seed}, {metrics_file} is missing, empty or truncated")
+            continue
+
+        reactive_n, auc, to_99 = convergence
+        convergence_by_bucket.setdefault(reactive_n, []).append((auc, to_99))
+
+    convergence = {}
+    for reactive_n, values in sorted(convergence_by_bucket.items()):
+        auc = mean(value[0] for value in values)
+        reached = [value[1] for value in values if value[1] is not None]
+        to_99 = mean(reached) if len(reached) > 0 else None
+
+        to_99_text = f"{to_99:.1f}" if to_99 is not None else "-"
+        print(f"reactiveN {reactive_n}: AUC {auc:.4f}, interactions to 99% {to_99_text} ({len(values)} seeds)")
+
+        convergence[reactive_n] = {"seeds": len(values), "auc": auc, "interactionsTo99": to_99}
+
+    with (output_directory / "convergence.json").open("w+", encoding="utf-8") as file:
+        json.dump(convergence, file)
+
+def import_output_directories(store: ResultsStore) -> None:
+    """Fills a new results store with the scores of the logs in the output directories."""
     outputs_root = Path(__file__).parent / "output"
+    if not outputs_root.is_dir():
+        return
 
-    for directory in outputs_root.iterdir():
-        scores_by_seed = {}
+    rows = []
+    for directory in sorted(outputs_root.iterdir()):
+        for file in directory.glob("*.log"):
+            usage = get_usage_from_logs(file)
+            rows.append({
+                "seed": int(file.stem),
+                "solver": directory.name,
+                "score": get_score_from_logs(file),
+                "solver_cpu_ms": usage.get("solver_user_ms", 0.0) + usage.get("solver_sys_ms", 0.0),
+                "solver_max_rss_kb": usage.get("solver_max_rss_kb", 0.0),
+                "timestamp": file.stat().st_mtime,
+                "metadata": json.dumps({"imported": True})
+            })
 
-        for file in directory.iterdir():
-            if file.name.endswith(".log"):
-                scores_by_seed[file.stem] = get_score_from_logs(file)
+    store.append(rows)
 
-        scores_by_solver[directory.name] = scores_by_seed
+def update_overview() -> None:
+    store = ResultsStore(get_default_store_file())
+    if not store.exists():
+        import_output_directories(store)
+
+    scores_by_solver = store.scores_by_solver()
 
     overview_template_file = Path(__file__).parent / "overview.tmpl.html"
     overview_file = Path(__file__).parent / "overview.html"
 
+    heatmaps_file = Path(__file__).parent / "heatmaps.json"
+    heatmaps = heatmaps_file.read_text(encoding="utf-8") if heatmaps_file.is_file() else "{}"
+
     overview_template = overview_template_file.read_text(encoding="utf-8")
     overview = overview_template.replace("/* scores_by_solver */{}", json.dumps(scores_by_solver))
+    overview = overview.replace("/* heatmaps */{}", heatmaps)
 
     with overview_file.open("w+", encoding="utf-8") as file:
         file.write(overview)
 
     print(f"Overview: file://{overview_file}")
 
-def run_seed(solver: Path, seed: int, output_directory: Path) -> int:
+def get_input_file(seed: int) -> Path:
     input_file = Path(__file__).parent / "input" / f"{seed}.in"
     if not input_file.is_file():
-        args_input_file = input_file.parent / f"{seed}."
-        generated_input_file = input_file.parent / f"{seed}.0000.txt"
+        # unique per process, so concurrent runners (see jobqueue.py) never write to the same file
+        args_input_file = input_file.parent / f"{seed}.{os.getpid()}."
+        generated_input_file = input_file.parent / f"{seed}.{os.getpid()}.0000.txt"
         generator = Path(__file__).parent.parent / "cmake-build-release" / "generator"
 
         subprocess.run([str(generator), str(args_input_file)], input=f"-seed {seed}\n".encode("utf-8"))
 
-        generated_input_file.rename(input_file)
+        generated_input_file.replace(input_file)
+
+    return input_file
+
+def get_cpu_slots() -> List[List[int]]:
+    """Groups the usable CPUs into one slot per judge/solver pair.
+
+    A slot is the hardware threads of one physical core, or two physical cores on machines without SMT, so there are
+    never more pairs running than physical cores.
+    """
+    cores: Dict[str, List[int]] = {}
+    for cpu in sorted(os.sched_getaffinity(0)):
+        siblings_file = Path(f"/sys/devices/system/cpu/cpu{cpu}/topology/thread_siblings_list")
+        siblings = siblings_file.read_text(encoding="utf-8").strip() if siblings_file.is_file() else str(cpu)
+        cores.setdefault(siblings, []).append(cpu)
+
+    physical_cores = list(cores.values())
+    if len(physical_cores) == 1 or any(len(cpus) > 1 for cpus in physical_cores):
+        return physical_cores
+
+    return [physical_cores[i] + physical_cores[i + 1] for i in range(0, len(physical_cores) - 1, 2)]
+
+def pin_worker(slots: Queue) -> None:
+    # the judge and the solver inherit the affinity of the pool worker
+    os.sched_setaffinity(0, slots.get())
+
+def get_max_score(seed: int) -> Optional[int]:
+    """Returns the score upper bound of the seed from lower_bound, None if lower_bound is not built.
+
+    The bounds are cached in results/bounds, so the input directory only holds inputs.
+    """
+    bound_file = Path(__file__).parent / "bounds" / f"{seed}.bound"
+
+    if not bound_file.is_file():
+        lower_bound = Path(__file__).parent.parent / "cmake-build-release" / "lower_bound"
+        if not lower_bound.is_file():
+            return None
+
+        process = subprocess.run([str(lower_bound), str(get_input_file(seed))], capture_output=True, check=True)
+        max_score = int(process.stdout.decode("utf-8").splitlines()[1].split("\t")[2])
+        bound_file.parent.mkdir(exist_ok=True)
+        bound_file.write_text(f"{max_score}\n", encoding="utf-8")
+
+    return int(bound_file.read_text(encoding="utf-8"))
+
+def run_seed(solver: Path, seed: int, output_directory: Path, transcripts: bool = False) -> Tuple[int, float]:
+    """transcripts writes the judge's replies for heatmap.py, it is off by default to keep that I/O out of the timing."""
+    input_file = get_input_file(seed)
 
     judge = Path(__file__).parent.parent / "cmake-build-release" / "judge"
     output_file = output_directory / f"{seed}.out"
     logs_file = output_directory / f"{seed}.log"
+    metrics_file = output_directory / f"{seed}.metrics"
+    transcript_file = output_directory / f"{seed}.transcript"
+
+    judge_options = ["-metrics", str(metrics_file)]
+    if transcripts:
+        judge_options += ["-transcript", str(transcript_file)]
+    else:
+        # a transcript of an earlier run would not match this output
+        transcript_file.unlink(missing_ok=True)
 
     with input_file.open("rb") as input:
         with output_file.open("wb+") as output:
             with logs_file.open("wb+") as logs:
                 try:
-                    process = subprocess.run([str(judge), str(solver)],
+                    start_time = time.perf_counter()
+                    process = subprocess.run([str(judge), str(solver)] + judge_options,
                                              stdin=input,
                                              stdout=output,
                                              stderr=logs,
                                              timeout=5)
+                    wall_time = time.perf_counter() - start_time
 
                     if process.returncode != 0:
                         raise RuntimeError(f"Judge exited with status code {process.returncode} for seed {seed}")
 
-                    return get_score_from_logs(logs_file)
+                    return get_score_from_logs(logs_file), wall_time
                 except subprocess.TimeoutExpired:
                     raise RuntimeError(f"Judge timed out for seed {seed}")
 
-def run(solver: Path, seeds: List[int], output_directory: Path) -> None:
+def print_timing(seeds: List[int], wall_times: List[List[float]]) -> None:
+    """Prints the wall time per trial and how much it varies, wall_times[trial][seed index]."""
+    totals = [sum(trial) for trial in wall_times]
+    print(f"Wall time: {mean(totals):,.3f} s per trial", end="")
+
+    if len(wall_times) > 1:
+        total_cv = stdev(totals) / mean(totals)
+        seed_cvs = [stdev(times) / mean(times) for times in zip(*wall_times)]
+        noisiest = max(range(len(seeds)), key=lambda i: seed_cvs[i])
+
+        print(f", stdev {stdev(totals):,.3f} s (CV {total_cv:.2%}) over {len(wall_times)} trials, "
+              f"per-seed CV median {median(seed_cvs):.2%}, max {seed_cvs[noisiest]:.2%} (seed {seeds[noisiest]})")
+    else:
+        print()
+
+def run(solver: Path, seeds: List[int], output_directory: Path, pin: bool = False, trials: int = 1,
+        transcripts: bool = False) -> None:
     if not output_directory.is_dir():
         output_directory.mkdir(parents=True)
 
-    with Pool() as pool:
-        scores = pool.starmap(run_seed, [(solver, seed, output_directory) for seed in seeds])
+    if pin:
+        slots = get_cpu_slots()
+        slot_queue = Queue()
+        for slot in slots:
+            slot_queue.put(slot)
+
+        print(f"Pinning to {len(slots)} slots: {' '.join(','.join(map(str, slot)) for slot in slots)}")
+        pool = Pool(len(slots), initializer=pin_worker, initargs=(slot_queue,))
+    else:
+        pool = Pool()
+
+    with pool:
+        wall_times = []
+        for _ in range(trials):
+            results = pool.starmap(run_seed, [(solver, seed, output_directory, transcripts) for seed in seeds])
+            scores = [result[0] for result in results]
+            wall_times.append([result[1] for result in results])
 
+    timestamp = time.time()
+    metadata = json.dumps({"pin": pin, "trials": trials})
+    rows = []
     for i, seed in enumerate(seeds):
-        print(f"{seed}: {scores[i]:,.0f}")
+        usage = get_usage_from_logs(output_directory / f"{seed}.log")
+        rows.append({
+            "seed": seed,
+            "solver": output_directory.name,
+            "score": scores[i],
+            "wall_time": mean(trial[i] for trial in wall_times),
+            "solver_cpu_ms": usage.get("solver_user_ms", 0.0) + usage.get("solver_sys_ms", 0.0),
+            "solver_max_rss_kb": usage.get("solver_max_rss_kb", 0.0),
+            "timestamp": timestamp,
+            "metadata": metadata
+        })
+
+    ResultsStore(get_default_store_file()).append(rows)
+
+    # the bounds are only reported, the results are stored before lower_bound runs
+    with Pool() as pool:
+        max_scores = pool.map(get_max_score, seeds)
+    if None in max_scores:
+        for i, seed in enumerate(seeds):
+            print(f"{seed}: {scores[i]:,.0f}")
+        print("Gap to bound skipped, lower_bound is not built")
+    else:
+        # the gap is in score points, 1e9 points is a factor 10 in weekly cost
+        gaps = [max_score - score for score, max_score in zip(scores, max_scores)]
+        for i, seed in enumerate(seeds):
+            print(f"{seed}: {scores[i]:,.0f} (gap to bound {gaps[i]:,.0f})")
+
+        if len(seeds) > 1:
+            print(f"Gap to bound: mean {mean(gaps):,.0f}, median {median(gaps):,.0f}, "
+                  f"{sum(1 for gap in gaps if gap < 0.01 * 1e9)} seeds within 1e7")
 
     if len(seeds) > 1:
         print(f"Total score: {sum(scores):,.0f}")
 
+    print_timing(seeds, wall_times)
+    print_usage(output_directory, seeds)
+    print_convergence(output_directory, seeds)
+
 def main() -> None:
     parser = argparse.ArgumentParser(description="Run a solver.")
     parser.add_argument("solver", type=str, help="the solver to run")
     parser.add_argument("--seed", type=int, help="the seed to run (defaults to 1-100)")
+    parser.add_argument("--seeds-file", type=str, help="file with the seeds to run, one per line (see subset.py)")
+    parser.add_argument("--pin", action="store_true", help="pin every judge/solver pair to its own physical core(s)")
+    parser.add_argument("--trials", type=int, default=1, help="number of times to run every seed, for timing noise")
+    parser.add_argument("--transcripts", action="store_true", help="write the judge's replies for heatmap.py")
 
     args = parser.parse_args()
 
@@ -96,13 +333,16 @@ def main() -> None:
 
     output_directory = Path(__file__).parent / "output" / args.solver
 
-    if args.seed is None:
+    if args.seeds_file is not None:
+        seeds = [int(line) for line in Path(args.seeds_file).read_text(encoding="utf-8").split()]
+        run(solver, seeds, output_directory, args.pin, args.trials, args.transcripts)
+    elif args.seed is None:
         if output_directory.is_dir():
             shutil.rmtree(output_directory)
 
-        run(solver, list(range(1, 101)), output_directory)
+        run(solver, list(range(1, 101)), output_directory, args.pin, args.trials, args.transcripts)
     else:
-        run(solver, [args.seed], output_directory)
+        run(solver, [args.seed], output_directory, args.pin, args.trials, args.transcripts)
 
     update_overview()
 
@@ -0,0 +1,247 @@
+import argparse
+import json
+import struct
+import time
+from array import array
+from pathlib import Path
+from typing import Any, Dict, Iterable, List, Optional, Set, Tuple
+
+# Append-only columnar store of benchmark results.
+#
+# The store file is a sequence of blocks, one per runner invocation. A block is
+#   b"ARSB", uint32 header length, JSON header, column payloads
+# where the header holds the number of rows, the string table of the block and per column its type and the offset
+# and length of its payload relative to the end of the header. Integer columns are int64, float columns are float64
+# and string columns are uint32 indices into the string table.
+#
+# The index sidecar (<store>.idx) lists per block its offset, its solvers and its seed range, so a query only reads the
+# blocks and the columns it needs. It is rebuilt from the store if it is missing or behind. When a (solver, seed)
+# appears in several blocks the row of the latest block wins.
+
+MAGIC = b"ARSB"
+
+COLUMNS = {
+    "seed": "i64",
+    "solver": "str",
+    "score": "i64",
+    "wall_time": "f64",
+    "solver_cpu_ms": "f64",
+    "solver_max_rss_kb": "f64",
+    "timestamp": "f64",
+    "metadata": "str"
+}
+
+ARRAY_TYPES = {"i64": "q", "f64": "d", "str": "I"}
+
+def get_default_store_file() -> Path:
+    return Path(__file__).parent / "results.store"
+
+class ResultsStore:
+    def __init__(self, store_file: Path) -> None:
+        self.store_file = store_file
+        self.index_file = store_file.with_name(store_file.name + ".idx")
+
+    def exists(self) -> bool:
+        return self.store_file.is_file()
+
+    def append(self, rows: List[Dict[str, Any]]) -> None:
+        """Appends the rows as one block, missing columns get their type's default."""
+        if len(rows) == 0:
+            return
+
+        strings: List[str] = []
+        string_ids: Dict[str, int] = {}
+
+        def get_string_id(value: str) -> int:
+            if value not in string_ids:
+                string_ids[value] = len(strings)
+                strings.append(value)
+            return string_ids[value]
+
+        payloads = []
+        columns = {}
+        offset = 0
+        for name, column_type in COLUMNS.items():
+            if column_type == "str":
+                values = [get_string_id(str(row.get(name, ""))) for row in rows]
+            elif column_type == "i64":
+                values = [int(row.get(name, 0)) for row in rows]
+            else:
+                values = [float(row.get(name, 0.0)) for row in rows]
+
+            payload = array(ARRAY_TYPES[column_type], values).tobytes()
+            columns[name] = {"type": column_type, "offset": offset, "length": len(payload)}
+            payloads.append(payload)
+            offset += len(payload)
+
+        header = json.dumps({"rows": len(rows), "strings": strings, "columns": columns}).encode("utf-8")
+        block = MAGIC + struct.pack("<I", len(header)) + header + b"".join(payloads)
+
+        index = self._read_index()
+
+        if self.exists() and self.store_file.stat().st_size > index["size"]:
+            # drop the partial block of an interrupted append
+            with self.store_file.open("r+b") as file:
+                file.truncate(index["size"])
+
+        with self.store_file.open("ab") as file:
+            block_offset = file.tell()
+            file.write(block)
+
+        seeds = [int(row.get("seed", 0)) for row in rows]
+        index["blocks"].append({
+            "offset": block_offset,
+            "length": len(block),
+            "solvers": sorted({str(row.get("solver", "")) for row in rows}),
+            "seedMin": min(seeds),
+            "seedMax": max(seeds)
+        })
+        index["size"] = block_offset + len(block)
+        self._write_index(index)
+
+    def query(self,
+              columns: Iterable[str],
+              solvers: Optional[Set[str]] = None,
+              seeds: Optional[Set[int]] = None) -> Dict[Tuple[str, int], Dict[str, Any]]:
+        """Returns the latest row per (solver, seed) with the requested columns."""
+        columns = set(columns) | {"solver", "seed"}
+        result: Dict[Tuple[str, int], Dict[str, Any]] = {}
+
+        if not self.exists():
+            return result
+
+        seed_min = min(seeds) if seeds else None
+        seed_max = max(seeds) if seeds else None
+
+        with self.store_file.open("rb") as file:
+            for block in self._read_index()["blocks"]:
+                if solvers is not None and solvers.isdisjoint(block["solvers"]):
+                    continue
+                if seeds and (block["seedMax"] < seed_min or block["seedMin"] > seed_max):
+                    continue
+
+                for row in self._read_block(file, block["offset"], columns):
+                    if solvers is not None and row["solver"] not in solvers:
+                        continue
+                    if seeds and row["seed"] not in seeds:
+                        continue
+
+                    result[(row["solver"], row["seed"])] = row
+
+        return result
+
+    def scores_by_solver(self) -> Dict[str, Dict[str, int]]:
+        scores: Dict[str, Dict[str, int]] = {}
+        for (solver, seed), row in self.query(["score"]).items():
+            scores.setdefault(solver, {})[str(seed)] = row["score"]
+
+        return scores
+
+    def _read_block(self, file: Any, offset: int, columns: Set[str]) -> List[Dict[str, Any]]:
+        file.seek(offset)
+        magic, header_length = struct.unpack("<4sI", file.read(8))
+        if magic != MAGIC:
+            raise RuntimeError(f"Corrupt results store, no block at offset {offset} of {self.store_file}")
+
+        header = json.loads(file.read(header_length).decode("utf-8"))
+        payload_offset = offset + 8 + header_length
+
+        rows: List[Dict[str, Any]] = [{} for _ in range(header["rows"])]
+        for name, column in header["columns"].items():
+            if name not in columns:
+                continue
+
+            file.seek(payload_offset + column["offset"])
+            values = array(ARRAY_TYPES[column["type"]])
+            values.frombytes(file.read(column["length"]))
+
+            if column["type"] == "str":
+                values = [header["strings"][value] for value in values]
+
+            for row, value in zip(rows, values):
+                row[name] = value
+
+        return rows
+
+    def _read_index(self) -> Dict[str, Any]:
+        index: Dict[str, Any] = {"size": 0, "blocks": []}
+        if not self.exists():
+            return index
+
+        store_size = self.store_file.stat().st_size
+        if self.index_file.is_file():
+            index = json.loads(self.index_file.read_text(encoding="utf-8"))
+
+        if index["size"] != store_size:
+            index = self._rebuild_index(store_size)
+
+        return index
+
+    def _rebuild_index(self, store_size: int) -> Dict[str, Any]:
+        index: Dict[str, Any] = {"size": 0, "blocks": []}
+
+        with self.store_file.open("rb") as file:
+            offset = 0
+            while offset + 8 <= store_size:
+                file.seek(offset)
+                magic, header_length = struct.unpack("<4sI", file.read(8))
+                if magic != MAGIC or offset + 8 + header_length > store_size:
+                    break
+
+                header = json.loads(file.read(header_length).decode("utf-8"))
+                length = 8 + header_length + sum(column["length"] for column in header["columns"].values())
+                if offset + length > store_size:
+                    # cut off by an interrupted append, readers ignore it and the next append truncates it
+                    break
+
+                rows = self._read_block(file, offset, {"solver", "seed"})
+                seeds = [row["seed"] for row in rows]
+                index["blocks"].append({
+                    "offset": offset,
+                    "length": length,
+                    "solvers": sorted({row["solver"] for row in rows}),
+                    "seedMin": min(seeds),
+                    "seedMax": max(seeds)
+                })
+
+                offset += length
+
+        index["size"] = offset
+        self._write_index(index)
+        return index
+
+    def _write_index(self, index: Dict[str, Any]) -> None:
+        temporary_file = self.index_file.with_name(self.index_file.name + ".tmp")
+        temporary_file.write_text(json.dumps(index, separators=(",", ":")), encoding="utf-8")
+        temporary_file.replace(self.index_file)
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description="Query the results store.")
+    parser.add_argument("solvers", type=str, nargs="*", help="the solvers to show (defaults to all)")
+    parser.add_argument("--seeds-file", type=str, help="file with the seeds to show, one per line (see subset.py)")
+
+    args = parser.parse_args()
+
+    seeds = None
+    if args.seeds_file is not None:
+        seeds = {int(line) for line in Path(args.seeds_file).read_text(encoding="utf-8").split()}
+
+    store = ResultsStore(get_default_store_file())
+    solvers = set(args.solvers) if len(args.solvers) > 0 else None
+    rows = store.query(["score", "wall_time", "solver_cpu_ms", "timestamp"], solvers, seeds)
+
+    by_solver: Dict[str, List[Dict[str, Any]]] = {}
+    for (solver, _), row in rows.items():
+        by_solver.setdefault(solver, []).append(row)
+
+    for solver, solver_rows in sorted(by_solver.items()):
+        total_score = sum(row["score"] for row in solver_rows)
+        wall_time = sum(row["wall_time"] for row in solver_rows)
+        solver_cpu = sum(row["solver_cpu_ms"] for row in solver_rows)
+        updated = time.strftime("%Y-%m-%d %H:%M", time.localtime(max(row["timestamp"] for row in solver_rows)))
+
+        print(f"{solver}: {len(solver_rows)} seeds, total score {total_score:,.0f}, "
+              f"wall time {wall_time:,.1f} s, solver CPU {solver_cpu:,.0f} ms, updated {updated}")
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,91 @@
+import argparse
+import subprocess
+from multiprocessing import Pool
+from pathlib import Path
+from statistics import mean, pstdev
+from typing import Dict, List
+
+from run import get_input_file
+
+NUMERIC_FEATURES = ["resourceN", "week", "procN", "operationN", "opsPerResourceWeek", "workRatio",
+                    "maxResourceWorkRatio", "routeLength", "costSpread"]
+
+def get_features(seeds: List[int]) -> Dict[int, Dict[str, float]]:
+    with Pool() as pool:
+        input_files = pool.map(get_input_file, seeds)
+
+    features_binary = Path(__file__).parent.parent / "cmake-build-release" / "features"
+    output = subprocess.run([str(features_binary)] + [str(file) for file in input_files],
+                            capture_output=True, check=True).stdout.decode("utf-8")
+
+    lines = output.splitlines()
+    header = lines[0].split("\t")
+
+    features_by_seed = {}
+    for seed, line in zip(seeds, lines[1:]):
+        values = line.split("\t")
+        features_by_seed[seed] = {name: float(value) for name, value in zip(header[1:], values[1:])}
+
+    return features_by_seed
+
+def select_subset(features_by_seed: Dict[int, Dict[str, float]], size: int, bins: int) -> List[int]:
+    """Stratifies by reactiveN and work ratio quantile and picks evenly spaced seeds from every stratum."""
+    statistics = {}
+    for name in NUMERIC_FEATURES:
+        values = [features[name] for features in features_by_seed.values()]
+        statistics[name] = (mean(values), pstdev(values) or 1.0)
+
+    def get_composite(seed: int) -> float:
+        return mean((features_by_seed[seed][name] - statistics[name][0]) / statistics[name][1]
+                    for name in NUMERIC_FEATURES)
+
+    strata: Dict[tuple, List[int]] = {}
+    for reactive_n in sorted({int(features["reactiveN"]) for features in features_by_seed.values()}):
+        seeds = sorted((seed for seed, features in features_by_seed.items() if features["reactiveN"] == reactive_n),
+                       key=lambda seed: features_by_seed[seed]["workRatio"])
+
+        for i, seed in enumerate(seeds):
+            strata.setdefault((reactive_n, i * bins // len(seeds)), []).append(seed)
+
+    # Largest remainder allocation proportional to the stratum sizes
+    total = len(features_by_seed)
+    quotas = {key: size * len(seeds) / total for key, seeds in strata.items()}
+    allocation = {key: min(len(strata[key]), int(quota)) for key, quota in quotas.items()}
+    for key in sorted(quotas, key=lambda key: quotas[key] - int(quotas[key]), reverse=True):
+        if sum(allocation.values()) >= size:
+            break
+        if allocation[key] < len(strata[key]):
+            allocation[key] += 1
+
+    subset = []
+    for key, seeds in strata.items():
+        count = allocation[key]
+        if count == 0:
+            continue
+
+        seeds = sorted(seeds, key=get_composite)
+        subset.extend(seeds[int((i + 0.5) * len(seeds) / count)] for i in range(count))
+
+    return sorted(subset)
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description="Select a stratified representative subset of seeds.")
+    parser.add_argument("size", type=int, help="the number of seeds to select")
+    parser.add_argument("--seeds", type=int, default=100, help="select from seeds 1..SEEDS (defaults to 100)")
+    parser.add_argument("--bins", type=int, default=3, help="work ratio bins per reactiveN (defaults to 3)")
+    parser.add_argument("--output", type=str, help="file to write the seeds to (defaults to stdout)")
+
+    args = parser.parse_args()
+
+    features_by_seed = get_features(list(range(1, args.seeds + 1)))
+    subset = select_subset(features_by_seed, args.size, args.bins)
+
+    content = "\n".join(str(seed) for seed in subset) + "\n"
+    if args.output is not None:
+        Path(args.output).write_text(content, encoding="utf-8")
+        print(f"Wrote {len(subset)} seeds to {args.output}")
+    else:
+        print(content, end="")
+
+if __name__ == "__main__":
+    main()
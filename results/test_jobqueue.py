@@ -0,0 +1,74 @@
+import json
+import tempfile
+import threading
+import time
+import unittest
+from pathlib import Path
+
+import jobqueue
+
+# Local checks of the job queue's file protocol, run by ctest. The heartbeat interval is shortened so the heartbeat
+# thread races with the requeue.
+
+class RequeueWhileBeatingTest(unittest.TestCase):
+    def setUp(self) -> None:
+        self.directory = tempfile.TemporaryDirectory()
+        self.queue_directory = Path(self.directory.name)
+        self.heartbeat_interval = jobqueue.HEARTBEAT_INTERVAL
+        jobqueue.HEARTBEAT_INTERVAL = 0.0005
+
+    def tearDown(self) -> None:
+        jobqueue.HEARTBEAT_INTERVAL = self.heartbeat_interval
+        self.directory.cleanup()
+
+    def get_files(self, name: str, pattern: str = "*.json") -> list:
+        return sorted((self.queue_directory / name).glob(pattern))
+
+    def test_requeue_while_beating(self) -> None:
+        jobqueue.enqueue(self.queue_directory, "v00", [1])
+
+        for attempt in range(1, jobqueue.MAX_ATTEMPTS):
+            running_file = jobqueue.claim_job(self.queue_directory, "worker")
+            self.assertIsNotNone(running_file)
+
+            stop = threading.Event()
+            thread = threading.Thread(target=jobqueue.heartbeat, args=(running_file, stop))
+            thread.start()
+            time.sleep(0.01)
+
+            # a stale timeout of zero requeues the job at once, while the heartbeat keeps writing
+            jobqueue.requeue_stale_jobs(self.queue_directory, 0.0, {})
+            time.sleep(0.01)
+            stop.set()
+            thread.join()
+
+            self.assertEqual(self.get_files("running"), [])
+            pending = self.get_files("pending")
+            self.assertEqual(len(pending), 1)
+            self.assertEqual(json.loads(pending[0].read_text(encoding="utf-8"))["attempts"], attempt)
+
+            # a later pass finds nothing to requeue and drops a beat file the heartbeat may have left behind
+            jobqueue.requeue_stale_jobs(self.queue_directory, 0.0, {})
+            self.assertEqual(len(self.get_files("pending")), 1)
+            self.assertEqual(self.get_files("running", "*.beat"), [])
+
+    def test_beating_job_is_not_requeued(self) -> None:
+        jobqueue.enqueue(self.queue_directory, "v00", [1])
+        running_file = jobqueue.claim_job(self.queue_directory, "worker")
+
+        stop = threading.Event()
+        thread = threading.Thread(target=jobqueue.heartbeat, args=(running_file, stop))
+        thread.start()
+
+        heartbeats = {}
+        for _ in range(20):
+            jobqueue.requeue_stale_jobs(self.queue_directory, 0.5, heartbeats)
+            time.sleep(0.01)
+        stop.set()
+        thread.join()
+
+        self.assertEqual(self.get_files("running"), [running_file])
+        self.assertEqual(self.get_files("pending"), [])
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,70 @@
+import argparse
+import struct
+from array import array
+from collections import defaultdict
+from pathlib import Path
+from typing import Dict, Iterator, List, Tuple
+
+COLUMNS = [("op", "i"), ("proc", "B"), ("res", "h"), ("start", "i"), ("end", "i"), ("late", "B")]
+
+def read_trace(trace_file: Path) -> Tuple[Dict[str, int], Iterator[Dict[str, array]]]:
+    """Reads a Gantt trace written by the judge's -trace option, returns the header and an iterator over interactions."""
+    data = trace_file.read_bytes()
+    if data[:4] != b"AGNT":
+        raise RuntimeError(f"{trace_file} is not a Gantt trace")
+
+    version, resource_n, week, operation_n = struct.unpack_from("<4i", data, 4)
+    header = {"version": version, "resourceN": resource_n, "week": week, "operationN": operation_n}
+
+    def blocks() -> Iterator[Dict[str, array]]:
+        offset = 20
+        while offset < len(data):
+            interaction, row_n = struct.unpack_from("<2i", data, offset)
+            offset += 8
+
+            block = {"interaction": interaction}
+            for name, type_code in COLUMNS:
+                column = array(type_code)
+                column.frombytes(data[offset:offset + row_n * column.itemsize])
+                offset += row_n * column.itemsize
+                block[name] = column
+
+            yield block
+
+    return header, blocks()
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description="Summarize a Gantt trace written by the judge.")
+    parser.add_argument("trace", type=str, help="the trace file")
+    parser.add_argument("--interaction", type=int,
+                        help="the interaction to summarize, counted from 1 (defaults to the last one)")
+
+    args = parser.parse_args()
+
+    header, blocks = read_trace(Path(args.trace))
+
+    # the judge numbers the interactions from 0 in the trace and from 1 everywhere else
+    selected = None
+    for block in blocks:
+        selected = block
+        if args.interaction is not None and block["interaction"] == args.interaction - 1:
+            break
+
+    if selected is None:
+        raise RuntimeError("Trace does not contain any interactions")
+    if args.interaction is not None and selected["interaction"] != args.interaction - 1:
+        raise RuntimeError(f"Trace does not contain interaction {args.interaction}")
+
+    late_time_by_resource: Dict[int, int] = defaultdict(int)
+    late_operations: Dict[int, List[int]] = defaultdict(list)
+    for i in range(len(selected["op"])):
+        if selected["late"][i]:
+            late_time_by_resource[selected["res"][i]] += selected["end"][i] - selected["start"][i]
+            late_operations[selected["res"][i]].append(selected["op"][i])
+
+    print(f"Interaction {selected['interaction'] + 1}, {len(selected['op'])} intervals")
+    for res, late_time in sorted(late_time_by_resource.items(), key=lambda item: -item[1]):
+        print(f"resource {res}: {late_time / 3600:.1f} hours of late operations ({len(set(late_operations[res]))} operations)")
+
+if __name__ == "__main__":
+    main()
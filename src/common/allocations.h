@@ -0,0 +1,145 @@
+#pragma once
+
+// Counts heap allocations and attributes them to the innermost named phase.
+// Enabled with -DCOUNT_ALLOCATIONS=ON, which force-includes this header into the judge and the solvers. It replaces
+// the global operator new and delete, so it must only end up in one translation unit per executable.
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+
+#include <unistd.h>
+
+struct AllocationStats {
+    const char *name = nullptr;
+    std::atomic<unsigned long long> allocations = 0;
+    std::atomic<unsigned long long> bytes = 0;
+};
+
+struct AllocationTable {
+    static constexpr int MAX_PHASES = 64;
+
+    AllocationStats phases[MAX_PHASES];
+    std::atomic<int> noPhases = 1;
+    std::mutex mutex;
+    pid_t pid;
+
+    AllocationTable() : pid(getpid()) {
+        phases[0].name = "(none)";
+    }
+
+    ~AllocationTable() {
+        // forked children (e.g. the judge's solver launcher) exit with a copy of the table
+        if (getpid() == pid) {
+            report();
+        }
+    }
+
+    int getPhase(const char *name) {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        for (int i = 0; i < noPhases; i++) {
+            if (std::strcmp(phases[i].name, name) == 0) {
+                return i;
+            }
+        }
+
+        if (noPhases == MAX_PHASES) {
+            return 0;
+        }
+
+        phases[noPhases].name = name;
+        return noPhases++;
+    }
+
+    void report() const {
+        unsigned long long totalAllocations = 0;
+        unsigned long long totalBytes = 0;
+
+        std::fprintf(stderr, "%-24s %14s %16s %12s\n", "phase", "allocations", "bytes", "bytes/alloc");
+
+        for (int i = 0; i < noPhases; i++) {
+            unsigned long long allocations = phases[i].allocations;
+            unsigned long long bytes = phases[i].bytes;
+
+            if (allocations == 0) {
+                continue;
+            }
+
+            totalAllocations += allocations;
+            totalBytes += bytes;
+
+            std::fprintf(stderr, "%-24s %14llu %16llu %12.1f\n",
+                         phases[i].name, allocations, bytes, (double) bytes / (double) allocations);
+        }
+
+        std::fprintf(stderr, "%-24s %14llu %16llu\n", "total", totalAllocations, totalBytes);
+    }
+};
+
+inline AllocationTable &getAllocationTable() {
+    static AllocationTable table;
+    return table;
+}
+
+inline thread_local int currentAllocationPhase = 0;
+
+class AllocationPhase {
+    int previousPhase;
+
+public:
+    explicit AllocationPhase(const char *name) : previousPhase(currentAllocationPhase) {
+        currentAllocationPhase = getAllocationTable().getPhase(name);
+    }
+
+    AllocationPhase(const AllocationPhase &) = delete;
+    AllocationPhase &operator=(const AllocationPhase &) = delete;
+
+    ~AllocationPhase() {
+        currentAllocationPhase = previousPhase;
+    }
+};
+
+#define ALLOCATION_PHASE_CONCAT_(a, b) a##b
+#define ALLOCATION_PHASE_CONCAT(a, b) ALLOCATION_PHASE_CONCAT_(a, b)
+#define ALLOCATION_PHASE(name) AllocationPhase ALLOCATION_PHASE_CONCAT(allocationPhase, __LINE__)(name)
+
+inline void *countedAllocate(std::size_t size) {
+    auto &stats = getAllocationTable().phases[currentAllocationPhase];
+    stats.allocations.fetch_add(1, std::memory_order_relaxed);
+    stats.bytes.fetch_add(size, std::memory_order_relaxed);
+
+    void *pointer = std::malloc(size == 0 ? 1 : size);
+    if (pointer == nullptr) {
+        throw std::bad_alloc();
+    }
+
+    return pointer;
+}
+
+void *operator new(std::size_t size) {
+    return countedAllocate(size);
+}
+
+void *operator new[](std::size_t size) {
+    return countedAllocate(size);
+}
+
+void operator delete(void *pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void *pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void *pointer, std::size_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void *pointer, std::size_t) noexcept {
+    std::free(pointer);
+}
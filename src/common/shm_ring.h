@@ -0,0 +1,220 @@
+#pragma once
+
+// Shared-memory transport between the judge and a solver.
+// The judge creates a memfd holding two single-producer single-consumer byte rings, one per direction, and passes the
+// file descriptor to the solver in ASPROCON9_SHM_FD. Readers and writers spin briefly and then sleep on a futex, the
+// other side only issues a wake syscall when it sees that somebody is sleeping. The bytes are the same text as on the
+// pipe transport, see shm_shim.h for the solver side.
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+
+#include <linux/futex.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace shm_ring {
+
+constexpr const char *FD_ENVIRONMENT_VARIABLE = "ASPROCON9_SHM_FD";
+
+constexpr std::uint32_t CAPACITY = 1 << 20;
+constexpr int SPIN_ITERATIONS = 1 << 14;
+constexpr long WAIT_TIMEOUT_NS = 50'000'000;
+
+static_assert((CAPACITY & (CAPACITY - 1)) == 0);
+static_assert(std::atomic<std::uint32_t>::is_always_lock_free && sizeof(std::atomic<std::uint32_t>) == 4);
+
+struct Ring {
+    // head and tail count the bytes written and read, they wrap around at 2^32 and are masked to index data
+    alignas(64) std::atomic<std::uint32_t> head;
+    std::atomic<std::uint32_t> readerWaiting;
+
+    alignas(64) std::atomic<std::uint32_t> tail;
+    std::atomic<std::uint32_t> writerWaiting;
+
+    alignas(64) std::atomic<std::uint32_t> closed;
+
+    alignas(64) char data[CAPACITY];
+};
+
+struct Channel {
+    Ring toSolver;
+    Ring toJudge;
+};
+
+inline void pause() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+// Spinning only pays off when the peer runs on another CPU at the same time
+inline int spinIterations() {
+    static const int iterations = [] {
+        cpu_set_t cpus;
+        return sched_getaffinity(0, sizeof(cpus), &cpus) == 0 && CPU_COUNT(&cpus) > 1 ? SPIN_ITERATIONS : 0;
+    }();
+
+    return iterations;
+}
+
+// Sleeps while word == value, returns false if the wait timed out
+inline bool futexWait(std::atomic<std::uint32_t> &word, std::uint32_t value) {
+    timespec timeout{0, WAIT_TIMEOUT_NS};
+    return syscall(SYS_futex, &word, FUTEX_WAIT, value, &timeout, nullptr, 0) == 0 || errno != ETIMEDOUT;
+}
+
+inline void futexWake(std::atomic<std::uint32_t> &word) {
+    syscall(SYS_futex, &word, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+
+// Waits until word != value or the ring is closed, returns false if alive() reports that the peer is gone
+template<typename Alive>
+bool waitWhileEqual(const Ring &ring, std::atomic<std::uint32_t> &word, std::uint32_t value,
+                    std::atomic<std::uint32_t> &waiting, Alive alive) {
+    for (int i = 0, n = spinIterations(); i < n; i++) {
+        if (word.load(std::memory_order_acquire) != value || ring.closed.load(std::memory_order_acquire)) {
+            return true;
+        }
+
+        pause();
+    }
+
+    // Pairs with the seq_cst store + load in publish(), either we see the new value or the other side sees waiting
+    waiting.store(1, std::memory_order_seq_cst);
+
+    bool result = true;
+    while (word.load(std::memory_order_seq_cst) == value && !ring.closed.load(std::memory_order_seq_cst)) {
+        if (!futexWait(word, value) && !alive()) {
+            result = false;
+            break;
+        }
+    }
+
+    waiting.store(0, std::memory_order_relaxed);
+    return result;
+}
+
+inline void publish(std::atomic<std::uint32_t> &word, std::uint32_t value, std::atomic<std::uint32_t> &waiting) {
+    word.store(value, std::memory_order_seq_cst);
+    if (waiting.load(std::memory_order_seq_cst)) {
+        futexWake(word);
+    }
+}
+
+// Writes all len bytes, blocking while the ring is full. Returns false if the reader closed the ring or is gone.
+template<typename Alive>
+bool write(Ring &ring, const char *buf, std::size_t len, Alive alive) {
+    std::uint32_t head = ring.head.load(std::memory_order_relaxed);
+
+    while (len > 0) {
+        if (ring.closed.load(std::memory_order_acquire)) {
+            return false;
+        }
+
+        std::uint32_t tail = ring.tail.load(std::memory_order_acquire);
+        std::uint32_t space = CAPACITY - (head - tail);
+        if (space == 0) {
+            if (!waitWhileEqual(ring, ring.tail, tail, ring.writerWaiting, alive)) {
+                return false;
+            }
+
+            continue;
+        }
+
+        std::uint32_t count = (std::uint32_t) std::min<std::size_t>(len, space);
+        std::uint32_t offset = head & (CAPACITY - 1);
+        std::uint32_t first = std::min(count, CAPACITY - offset);
+
+        std::memcpy(ring.data + offset, buf, first);
+        std::memcpy(ring.data, buf + first, count - first);
+
+        head += count;
+        buf += count;
+        len -= count;
+
+        publish(ring.head, head, ring.readerWaiting);
+    }
+
+    return true;
+}
+
+// Reads at most len bytes, blocking until at least one byte is available. Returns 0 at the end of the stream.
+template<typename Alive>
+std::size_t read(Ring &ring, char *buf, std::size_t len, Alive alive) {
+    std::uint32_t tail = ring.tail.load(std::memory_order_relaxed);
+    std::uint32_t head;
+
+    while ((head = ring.head.load(std::memory_order_acquire)) == tail) {
+        if (ring.closed.load(std::memory_order_acquire)) {
+            // the writer may have published its last bytes right before closing
+            if ((head = ring.head.load(std::memory_order_acquire)) != tail) {
+                break;
+            }
+
+            return 0;
+        }
+
+        if (!waitWhileEqual(ring, ring.head, tail, ring.readerWaiting, alive)) {
+            return 0;
+        }
+    }
+
+    std::uint32_t count = (std::uint32_t) std::min<std::size_t>(len, head - tail);
+    std::uint32_t offset = tail & (CAPACITY - 1);
+    std::uint32_t first = std::min(count, CAPACITY - offset);
+
+    std::memcpy(buf, ring.data + offset, first);
+    std::memcpy(buf + first, ring.data, count - first);
+
+    publish(ring.tail, tail + count, ring.writerWaiting);
+    return count;
+}
+
+inline void close(Ring &ring) {
+    ring.closed.store(1, std::memory_order_seq_cst);
+    futexWake(ring.head);
+    futexWake(ring.tail);
+}
+
+// Creates a channel in a new memfd, the descriptor is inherited across exec
+inline Channel *create(int &fd) {
+    fd = memfd_create("asprocon9-shm", 0);
+    if (fd < 0) {
+        return nullptr;
+    }
+
+    if (ftruncate(fd, sizeof(Channel)) < 0) {
+        ::close(fd);
+        return nullptr;
+    }
+
+    void *memory = mmap(nullptr, sizeof(Channel), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (memory == MAP_FAILED) {
+        ::close(fd);
+        return nullptr;
+    }
+
+    // a new memfd is zero-filled, which is an empty open ring
+    return static_cast<Channel *>(memory);
+}
+
+inline Channel *attach(int fd) {
+    void *memory = mmap(nullptr, sizeof(Channel), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    return memory == MAP_FAILED ? nullptr : static_cast<Channel *>(memory);
+}
+
+inline void detach(Channel *channel) {
+    munmap(channel, sizeof(Channel));
+}
+
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+// Solver side of the shared-memory transport (see shm_ring.h).
+// Force-included into the solvers by CMake when it is configured with -DSHM_TRANSPORT=ON (off by default). When the
+// judge starts a solver with -transport shm it sets ASPROCON9_SHM_FD, and std::cin and std::cout are redirected to the
+// rings before main runs. Without the variable the solver uses its regular stdin and stdout, so the same binary works
+// with both transports.
+
+#include <cstdlib>
+#include <iostream>
+#include <streambuf>
+
+#include "shm_ring.h"
+
+namespace shm_ring {
+
+inline bool alwaysAlive() {
+    // the judge kills the solver when it exits, see reactive_start_shm()
+    return true;
+}
+
+class InputBuffer : public std::streambuf {
+    Ring *ring = nullptr;
+    char buffer[1 << 16];
+
+public:
+    void open(Ring *ring) {
+        this->ring = ring;
+        setg(buffer, buffer, buffer);
+    }
+
+protected:
+    int_type underflow() override {
+        std::size_t count = read(*ring, buffer, sizeof(buffer), alwaysAlive);
+        if (count == 0) {
+            return traits_type::eof();
+        }
+
+        setg(buffer, buffer, buffer + count);
+        return traits_type::to_int_type(*gptr());
+    }
+};
+
+class OutputBuffer : public std::streambuf {
+    Ring *ring = nullptr;
+    char buffer[1 << 16];
+
+public:
+    void open(Ring *ring) {
+        this->ring = ring;
+        setp(buffer, buffer + sizeof(buffer));
+    }
+
+protected:
+    int_type overflow(int_type c) override {
+        if (sync() != 0) {
+            return traits_type::eof();
+        }
+
+        if (!traits_type::eq_int_type(c, traits_type::eof())) {
+            *pptr() = traits_type::to_char_type(c);
+            pbump(1);
+        }
+
+        return traits_type::not_eof(c);
+    }
+
+    int sync() override {
+        bool written = write(*ring, pbase(), pptr() - pbase(), alwaysAlive);
+        setp(buffer, buffer + sizeof(buffer));
+        return written ? 0 : -1;
+    }
+};
+
+struct Shim {
+    Channel *channel = nullptr;
+    InputBuffer input;
+    OutputBuffer output;
+    std::streambuf *previousInput = nullptr;
+    std::streambuf *previousOutput = nullptr;
+
+    Shim() {
+        const char *fd = std::getenv(FD_ENVIRONMENT_VARIABLE);
+        if (fd == nullptr || (channel = attach(std::atoi(fd))) == nullptr) {
+            return;
+        }
+
+        input.open(&channel->toSolver);
+        output.open(&channel->toJudge);
+
+        previousInput = std::cin.rdbuf(&input);
+        previousOutput = std::cout.rdbuf(&output);
+    }
+
+    ~Shim() {
+        if (channel == nullptr) {
+            return;
+        }
+
+        std::cout.flush();
+        std::cin.rdbuf(previousInput);
+        std::cout.rdbuf(previousOutput);
+
+        close(channel->toJudge);
+        detach(channel);
+    }
+};
+
+// Defined after std::ios_base::Init from <iostream>, so it is constructed after and destroyed before the streams
+static Shim shim;
+
+}
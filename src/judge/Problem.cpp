@@ -1,18 +1,151 @@
+#include <algorithm>
 #include <fstream>
 #include <cassert>
+#include <iostream>
+#include <charconv>
 #include <set>
+#include <string_view>
 #include "Problem.h"
 
 
-void ProblemVar::Output()
+namespace
+{
+    // Appends fields to one preallocated buffer with std::to_chars
+    // Doubles are written like the default ostream formatting (%g with precision 6).
+    class TextWriter
+    {
+    private:
+        string buf;
+
+        template<class T>
+        void WriteValue( T value )
+        {
+            char tmp[32];
+            auto [ptr, ec] = std::to_chars( tmp, tmp + sizeof( tmp ), value );
+            assert( ec == std::errc() );
+            buf.append( tmp, ptr );
+        }
+
+    public:
+        explicit TextWriter( size_t capacity )
+        {
+            buf.reserve( capacity );
+        }
+
+        TextWriter& operator<<( int value ) { WriteValue( value ); return *this; }
+        TextWriter& operator<<( long long value ) { WriteValue( value ); return *this; }
+        TextWriter& operator<<( size_t value ) { WriteValue( value ); return *this; }
+        TextWriter& operator<<( char c ) { buf.push_back( c ); return *this; }
+        TextWriter& operator<<( std::string_view s ) { buf.append( s ); return *this; }
+
+        TextWriter& operator<<( double value )
+        {
+            char tmp[32];
+            auto [ptr, ec] = std::to_chars( tmp, tmp + sizeof( tmp ), value, std::chars_format::general, 6 );
+            assert( ec == std::errc() );
+            buf.append( tmp, ptr );
+            return *this;
+        }
+
+        const string& str() const
+        {
+            return buf;
+        }
+
+        void clear()
+        {
+            buf.clear();
+        }
+    };
+
+    void WriteOperation( TextWriter& out, const ProblemVar::Operation& op )
+    {
+        out << op.opNo << '\t' << op.itemNo << '\t' << op.let << '\n';
+        for( auto& e : op.prodTime )
+        {
+            out << e << '\t';
+        }
+        out << '\n';
+    }
+
+    // Reads whitespace separated fields from one buffer with std::from_chars
+    // A field that is not a number of the expected type ends the program with an error message, also in release builds.
+    class TextReader
+    {
+    private:
+        const char* first;
+        const char* cur;
+        const char* last;
+
+        void SkipSpace()
+        {
+            while( cur != last && ( *cur == ' ' || *cur == '\t' || *cur == '\n' || *cur == '\r' ) ) cur++;
+        }
+
+        [[noreturn]] void Fail( const char* expected ) const
+        {
+            const char* end = cur;
+            while( end != last && end - cur < 20 && !( *end == ' ' || *end == '\t' || *end == '\n' || *end == '\r' ) ) end++;
+
+            cerr << "invalid input at line " << std::count( first, cur, '\n' ) + 1 << ": expected " << expected << ", found ";
+            if( cur == last ) cerr << "the end of the input" << endl;
+            else cerr << '"' << string( cur, end ) << '"' << endl;
+            exit( 1 );
+        }
+
+    public:
+        TextReader( const char* first, const char* last ) : first( first ), cur( first ), last( last )
+        {}
+
+        template<class T>
+        TextReader& operator>>( T& value )
+        {
+            SkipSpace();
+            if( cur != last && *cur == '+' ) cur++;
+            auto [ptr, ec] = std::from_chars( cur, last, value );
+            if( ec == std::errc::result_out_of_range ) Fail( "a number in range" );
+            if( ec != std::errc() ) Fail( "a number" );
+            cur = ptr;
+            return *this;
+        }
+
+        TextReader& operator>>( string& value )
+        {
+            SkipSpace();
+            const char* start = cur;
+            while( cur != last && !( *cur == ' ' || *cur == '\t' || *cur == '\n' || *cur == '\r' ) ) cur++;
+            value.assign( start, cur );
+            return *this;
+        }
+    };
+}
+
+
+string ProblemVar::GetOutputFileName() const
+{
+    string OUTPUT = to_string( inputNo );
+    while( OUTPUT.size() < 4 ) OUTPUT = '0' + OUTPUT;
+    return input_outputfile_name + OUTPUT + ".txt";
+}
+
+string ProblemVar::FormatOperation( const Operation& op )
+{
+    TextWriter out( 32 + op.prodTime.size() * 12 );
+    WriteOperation( out, op );
+    return out.str();
+}
+
+void ProblemVar::Output( const string& operationsFileName )
 {
     assert( generated == true );
     {
-        string OUTPUT = to_string( inputNo );
-        while( OUTPUT.size() < 4 ) OUTPUT = '0' + OUTPUT;
-        OUTPUT = input_outputfile_name + OUTPUT;
-        OUTPUT += ".txt";
-        ofstream out( OUTPUT );
+        const string OUTPUT = GetOutputFileName();
+        ofstream file( OUTPUT, ios::binary );
+
+        size_t capacity = 1024 + itemList.size() * 64 + resourceList.size() * 256 + opList.size() * 48 + costTypeA.size() * 24;
+        for( int i = 0; i < resourceN; i++ )
+            capacity += calendar[i].size() * 24 + originalCalendar.size() * ( week * 2 + 1 );
+        TextWriter out( capacity );
 
         out << week << '\n';
         out << resCalendarChangeLimitN << '\n';
@@ -20,45 +153,54 @@ void ProblemVar::Output()
         out << itemN << '\n';
         for( auto& e : itemList )
         {
-            out << e.itemNo << "	" << e.itemProcN << '\n';
-            out << e.prodTimeRange.first << "	" << e.prodTimeRange.second << '\n';
+            out << e.itemNo << '\t' << e.itemProcN << '\n';
+            out << e.prodTimeRange.first << '\t' << e.prodTimeRange.second << '\n';
             for( auto& e2 : e.proc )
             {
-                out << e2 << "	";
+                out << e2 << '\t';
             }
-            out << "\n";
+            out << '\n';
         }
 
         out << resourceN << '\n';
         for( auto& e : resourceList )
         {
             out << e.resNo << '\n';
-            out << e.procNo << "	" << e.resDemand << "	" << e.workerN << "	" << e.costPerHour << "	" << e.costPerHourNight << '\n';
-            out << e.costRatio << "	" << e.calendar0CostRatio << "	" << e.calendar1CostRatio << "\n";
+            out << e.procNo << '\t' << e.resDemand << '\t' << e.workerN << '\t' << e.costPerHour << '\t' << e.costPerHourNight << '\n';
+            out << e.costRatio << '\t' << e.calendar0CostRatio << '\t' << e.calendar1CostRatio << '\n';
             for( auto& e2 : e.calendarTypeXRatio )
             {
-                out << e2 << "	";
+                out << e2 << '\t';
             }
-            out << "\n";
+            out << '\n';
         }
 
         out << operationN << '\n';
-        for( auto& e : opList )
+        if( operationsFileName.empty() )
         {
-            out << e.opNo << "	" << e.itemNo << "	" << e.let << '\n';
-            for( auto& e2 : e.prodTime )
+            for( auto& e : opList )
             {
-                out << e2 << "	";
+                WriteOperation( out, e );
             }
-            out << "\n";
         }
+        else
+        {
+            // streamed by the generator, copied in chunks so the operations are never all in memory
+            file.write( out.str().data(), out.str().size() );
+            out.clear();
 
-        std::set<pair<int, int>>used;
+            ifstream operations( operationsFileName, ios::binary );
+            char chunk[1 << 16];
+            while( operations.read( chunk, sizeof( chunk ) ) || operations.gcount() > 0 )
+            {
+                file.write( chunk, operations.gcount() );
+            }
+        }
 
         out << costTypeA.size() << '\n';
         for( auto& e : costTypeA )
         {
-            out << e.second << "	" << costTypeB[e.first] << '\n';
+            out << e.second << '\t' << costTypeB[e.first] << '\n';
         }
 
 
@@ -73,25 +215,39 @@ void ProblemVar::Output()
             out << calendar[i].size() << '\n';
 
             for( auto& e : calendar[i] )
-                out << e.first << "	" << e.second << '\n';
+                out << e.first << '\t' << e.second << '\n';
 
             for( auto& e : originalCalendar )
                 out << e << '\n';
         }
         out << addCostHoliday << '\n';
-        out.close();
+
+        file.write( out.str().data(), out.str().size() );
     }
 }
 
 void ProblemVar::Input( istream &in )
+{
+    string data;
+    char chunk[1 << 16];
+    while( in.read( chunk, sizeof( chunk ) ) || in.gcount() > 0 )
+        data.append( chunk, in.gcount() );
+
+    Input( data.data(), data.data() + data.size() );
+}
+
+void ProblemVar::Input( const char* first, const char* last )
 {
     //dump( "input start" );
     assert( generated == false );
     {
+        TextReader in( first, last );
+
         in >> week;
         in >> resCalendarChangeLimitN;
         in >> reactiveN;
         in >> itemN;
+        itemList.reserve( itemN );
         for( int i = 0; i < itemN; i++ )
         {
             Item e;
@@ -106,6 +262,7 @@ void ProblemVar::Input( istream &in )
         }
 
         in >> resourceN;
+        resourceList.reserve( resourceN );
         for( int i = 0; i < resourceN; i++ )
         {
             Resource e;
@@ -121,6 +278,7 @@ void ProblemVar::Input( istream &in )
         }
 
         in >> operationN;
+        opList.reserve( operationN );
         for( int i = 0; i < operationN; i++ )
         {
             Operation e;
@@ -338,8 +338,11 @@ public:
     string input_outputfile_name = "";
     bool generated = false;
 
-    void Output();
+    string GetOutputFileName() const;
+    static string FormatOperation( const Operation& op ); // the lines of op in the input file format
+    void Output( const string& operationsFileName = "" ); // operationsFileName: operations written by FormatOperation, used instead of opList
     void Input( istream& );
+    void Input( const char* first, const char* last ); // parse an input file that is already in memory
 };
 
 
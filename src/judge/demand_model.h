@@ -0,0 +1,139 @@
+#pragma once
+
+#include <sstream>
+#include <string>
+#include <vector>
+#include "Problem.h"
+
+
+// Demand model of the judge's replies
+//
+// Approximates a reply from the header cost table alone, without the operations. The work of a resource-week is
+// estimated as load * capacity from the observed replies, and a calendar is evaluated by filling the weeks of
+// every resource in order and carrying the work that does not fit over to the next week. Resource-weeks that carry
+// work over are reported as late. Used by the mock judge to answer calendars that are not in its recording.
+struct DemandModel
+{
+    struct Reply
+    {
+        long long score = 0;
+        int changeLimitViolationCnt = 0;
+        int let = 0;
+        vector<double> loadRate; // [resource * week + week]
+        vector<int> letOpCount; // [resource * week + week]
+
+        // same text as the judge
+        std::string Format() const
+        {
+            std::stringstream ss;
+            ss << score << ' ' << changeLimitViolationCnt << ' ' << let << '\n';
+            for( size_t i = 0; i < loadRate.size(); i++ )
+            {
+                ss << std::to_string( loadRate[i] ) << ' ' << std::to_string( letOpCount[i] ).substr( 0, 5 ) << '\n';
+            }
+            return ss.str();
+        }
+    };
+
+    int week = 0;
+    int resourceN = 0;
+    int resCalendarChangeLimitN = 0;
+    int reactiveN = 0;
+    vector<vector<int>> costTypeA; // [resource][calendar type]
+    vector<vector<int>> costTypeB;
+    vector<double> demand; // estimated working hours, [resource * week + week]
+
+    // header: "week resourceN resCalendarChangeLimitN reactiveN" followed by resourceN * 9 cost lines
+    void ReadHeader( const vector<string>& lines )
+    {
+        std::stringstream( lines[0] ) >> week >> resourceN >> resCalendarChangeLimitN >> reactiveN;
+
+        const int typeN = static_cast<int>( Calendar.totalTime.size() );
+        costTypeA.assign( resourceN, vector<int>( typeN, 0 ) );
+        costTypeB.assign( resourceN, vector<int>( typeN, 0 ) );
+        for( int i = 0; i < resourceN; i++ )
+        {
+            for( int j = 0; j < typeN; j++ )
+            {
+                std::stringstream( lines[1 + i * typeN + j] ) >> costTypeA[i][j] >> costTypeB[i][j];
+            }
+        }
+
+        demand.assign( resourceN * week, 0.0 );
+    }
+
+    static int GetCapacity( char typeA, char typeB ) // working hours of a week
+    {
+        return 5 * Calendar.totalTime[typeA - '1'] + 2 * Calendar.totalTime[typeB - '1'];
+    }
+
+    // Update the demand estimate with the judge's reply to calendar
+    void Observe( const vector<string>& calendar, const Reply& reply )
+    {
+        for( int i = 0; i < resourceN; i++ )
+        {
+            for( int j = 0; j < week; j++ )
+            {
+                const int capacity = GetCapacity( calendar[i][j * 2], calendar[i][j * 2 + 1] );
+                if( capacity > 0 ) demand[i * week + j] = reply.loadRate[i * week + j] * capacity;
+            }
+        }
+    }
+
+    Reply Evaluate( const vector<string>& calendar ) const
+    {
+        Reply reply;
+        reply.loadRate.assign( resourceN * week, 0.0 );
+        reply.letOpCount.assign( resourceN * week, 0 );
+
+        long long cost = 0;
+        for( int i = 0; i < resourceN; i++ )
+        {
+            int cntCh = 0;
+            for( int j = 0; j < week * 2 - 2; j++ )
+            {
+                if( calendar[i][j] != calendar[i][j + 2] )
+                    cntCh++;
+            }
+            reply.changeLimitViolationCnt += std::max( 0, cntCh - resCalendarChangeLimitN );
+
+            double carry = 0.0;
+            for( int j = 0; j < week; j++ )
+            {
+                const char typeA = calendar[i][j * 2];
+                const char typeB = calendar[i][j * 2 + 1];
+                cost += costTypeA[i][typeA - '1'] + costTypeB[i][typeB - '1'];
+
+                const int capacity = GetCapacity( typeA, typeB );
+                const double work = demand[i * week + j] + carry;
+                const double done = std::min( work, static_cast<double>( capacity ) );
+                carry = work - done;
+
+                reply.loadRate[i * week + j] = done / std::max( 1, capacity );
+                if( carry > 1e-6 )
+                {
+                    reply.letOpCount[i * week + j] = 1;
+                    reply.let++;
+                }
+            }
+        }
+
+        if( reply.let + reply.changeLimitViolationCnt == 0 )
+            reply.score = round( ( 10.0 - log10( static_cast<double>( cost / week ) ) ) * 1e9 );
+        return reply;
+    }
+
+    // Parse a reply in the judge's format, lines[0] is the score line
+    Reply ParseReply( const vector<string>& lines ) const
+    {
+        Reply reply;
+        std::stringstream( lines[0] ) >> reply.score >> reply.changeLimitViolationCnt >> reply.let;
+        reply.loadRate.resize( resourceN * week );
+        reply.letOpCount.resize( resourceN * week );
+        for( int i = 0; i < resourceN * week; i++ )
+        {
+            std::stringstream( lines[1 + i] ) >> reply.loadRate[i] >> reply.letOpCount[i];
+        }
+        return reply;
+    }
+};
@@ -0,0 +1,76 @@
+// instance feature extraction
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include "Problem.h"
+
+
+// Prints one tab separated line of features per input file
+int main( int argc, char* argv[] )
+{
+    if( argc <= 1 )
+    {
+        cerr << "usage: " << argv[0] << " input-file...\n";
+        return 0;
+    }
+
+    cout << "file\treactiveN\tresourceN\tweek\tprocN\titemN\toperationN\tchangeLimit"
+         << "\topsPerResourceWeek\tworkRatio\tmaxResourceWorkRatio\trouteLength\tcostSpread\n";
+
+    for( int arg = 1; arg < argc; arg++ )
+    {
+        ifstream in( argv[arg] );
+        if( !in )
+        {
+            cerr << "cannot open input file " << argv[arg] << endl;
+            return 1;
+        }
+
+        ProblemVar P;
+        P.Input( in );
+
+        // working time of the original calendar
+        vector<long long> capacity( P.resourceN, 0 );
+        for( int i = 0; i < P.resourceN; i++ )
+            for( auto [startTime, endTime] : P.calendar[i] )
+                if( startTime < P.week * WEEK ) capacity[i] += endTime - startTime;
+
+        vector<long long> work( P.resourceN, 0 );
+        long long routeLength = 0;
+        for( auto& op : P.opList )
+        {
+            const auto& item = P.itemList[op.itemNo];
+            for( int i = 0; i < item.itemProcN; i++ )
+                work[item.proc[i]] += op.prodTime[i];
+            routeLength += item.itemProcN;
+        }
+
+        long long totalWork = 0, totalCapacity = 0;
+        double maxResourceWorkRatio = 0;
+        for( int i = 0; i < P.resourceN; i++ )
+        {
+            totalWork += work[i];
+            totalCapacity += capacity[i];
+            maxResourceWorkRatio = max( maxResourceWorkRatio, static_cast<double>( work[i] ) / max( 1LL, capacity[i] ) );
+        }
+
+        // spread of the standard pattern (pattern 4) cost over resources
+        int minCost = numeric_limits<int>::max(), maxCost = 0;
+        for( int i = 0; i < P.resourceN; i++ )
+        {
+            minCost = min( minCost, P.costTypeA[{i, 3}] );
+            maxCost = max( maxCost, P.costTypeA[{i, 3}] );
+        }
+
+        cout << argv[arg] << '\t' << P.reactiveN << '\t' << P.resourceN << '\t' << P.week << '\t' << P.procN
+             << '\t' << P.itemN << '\t' << P.operationN << '\t' << P.resCalendarChangeLimitN
+             << fixed << setprecision( 4 )
+             << '\t' << static_cast<double>( P.operationN ) / ( P.resourceN * P.week )
+             << '\t' << static_cast<double>( totalWork ) / max( 1LL, totalCapacity )
+             << '\t' << maxResourceWorkRatio
+             << '\t' << static_cast<double>( routeLength ) / max( 1, P.operationN )
+             << '\t' << static_cast<double>( maxCost ) / max( 1, minCost )
+             << defaultfloat << '\n';
+    }
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdio>
+#include <optional>
 #include "Problem.h"
 
 
@@ -10,6 +12,11 @@ class Generator : public ProblemVar
 {
 public:
 
+    // Stream the operations to a temporary file next to the output as they are generated instead of keeping them in
+    // opList, so the memory does not grow with the number of operations
+    bool streamOperations = false;
+    string operationsFileName;
+
 
     // ��������X�y�[�X��؂�ŕ��� ... seperate string with a whitespace character
     vector<string> split( string S )
@@ -42,6 +49,7 @@ public:
         input_outputfile_name = outputfile_name;
 
         unsigned long long seed = 0;
+        std::optional<int> weekOption, resourceNOption, itemNOption, changeLimitOption;
 
         // ���͂ɂ��p�����[�^�ύX ... process input parameter
         vector<string> argv = split( INPUT );
@@ -53,19 +61,19 @@ public:
 
             if( temp == "-week" )
             {
-                week = stoi( argv[i + 1] );
+                weekOption = stoi( argv[i + 1] );
             }
             else if( temp == "-resourceN" )
             {
-                resourceN = stoi( argv[i + 1] );
+                resourceNOption = stoi( argv[i + 1] );
             }
             else if( temp == "-itemN" )
             {
-                itemN = stoi( argv[i + 1] );
+                itemNOption = stoi( argv[i + 1] );
             }
             else if( temp == "-changeLimit" )
             {
-                resCalendarChangeLimitN = stoi( argv[i + 1] );
+                changeLimitOption = stoi( argv[i + 1] );
             }
             else if( temp == "-seed" )
             {
@@ -96,6 +104,12 @@ public:
             resCalendarChangeLimitN = param.changeLimitMin;
         }
 
+        // overrides are applied after the draws above, so they do not change the random stream of the other values
+        if( weekOption.has_value() ) week = *weekOption;
+        if( resourceNOption.has_value() ) resourceN = *resourceNOption;
+        if( itemNOption.has_value() ) itemN = *itemNOption;
+        if( changeLimitOption.has_value() ) resCalendarChangeLimitN = *changeLimitOption;
+
 
         // ���͂̐��� ... generate input data
         { // �����E�H���̐��� ... generate resource and process
@@ -248,6 +262,13 @@ public:
         // ��Ƃ͍��l�߂Ŋ���t���� ... Assign operations left aligned
 
 
+        ofstream operationsOut;
+        if( streamOperations )
+        {
+            operationsFileName = GetOutputFileName() + ".operations";
+            operationsOut.open( operationsFileName, ios::binary );
+        }
+
         auto CheckCapacity = [this, &t3, &ridx, END] ( Operation& op, bool assignFlag = false )
         {
             int totalSkip = 0;
@@ -404,7 +425,10 @@ public:
             Operation op = MIN.second;
             CheckCapacity( op, true );
             operationN++;
-            opList.emplace_back( op );
+            if( streamOperations )
+                operationsOut << FormatOperation( op );
+            else
+                opList.emplace_back( op );
 
         }
 
@@ -412,6 +436,12 @@ public:
 
     }
 
+    void Output()
+    {
+        ProblemVar::Output( operationsFileName );
+        if( !operationsFileName.empty() ) remove( operationsFileName.c_str() );
+    }
+
 
 };
 
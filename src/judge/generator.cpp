@@ -3,14 +3,22 @@
 #include "Problem.h"
 #include "gen.h"
 
+// usage: generator [output-prefix] [-stream]
+// -stream writes the operations to disk as they are generated, for instances with millions of operations
 int main( int argc, char* argv[] )
 {
     string outputfile_name = "";
-    if( argc >= 2 ) outputfile_name = argv[1];
+    bool streamOperations = false;
+    for( int i = 1; i < argc; i++ )
+    {
+        if( string( argv[i] ) == "-stream" ) streamOperations = true;
+        else outputfile_name = argv[i];
+    }
     string INPUT;
     for( int i = 0; getline( cin, INPUT ); i++ )
     {
         Generator G;
+        G.streamOperations = streamOperations;
         G.Generate( i, INPUT, outputfile_name );
         G.Output();
 
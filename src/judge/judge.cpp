@@ -1,11 +1,18 @@
 #include <fstream>
 #include <cassert>
+#include <iomanip>
 #include <vector>
 #include <iostream>
+#include <memory>
 #include <sstream>
 #include <string>
 
 #include "judge.h"
+#include "perf.h"
+
+#ifndef ALLOCATION_PHASE
+#define ALLOCATION_PHASE( name )
+#endif
 
 #ifdef _MSC_VER
 #define ASPROCON9_USE_RUNNER
@@ -13,7 +20,7 @@
 
 #ifdef ASPROCON9_USE_RUNNER
 
-int reactive_start( std::string )
+int reactive_start( std::string, bool = false )
 {
 	return 0;
 }
@@ -62,6 +69,78 @@ Judge create_judge( char* inputFileName = nullptr )
 }
 
 ostringstream vis_out;
+ofstream metrics_out; // per interaction score, cost and feasibility
+ofstream transcript_out; // everything written to and read from the solver
+ofstream perf_out;
+PerfProfiler* perf_profiler = nullptr;
+GanttTraceWriter trace_out;
+int rollingInterval = 0; // commit one more week every rollingInterval interactions, 0 simulates the whole horizon
+
+// Reply lines of the frozen weeks in rolling mode. The lines of a resource are only formatted again when an open
+// operation works in one of its frozen weeks.
+struct RollingReply
+{
+    vector<string> frozenLines; // [resource]
+
+    static void WriteLine( ostream& os, double loadRate, int letOpCount )
+    {
+        os << to_string( loadRate ) << ' ' << to_string( letOpCount ).substr( 0, 5 ) << '\n';
+    }
+
+    // Commit the next week with the calendar of input
+    void Freeze( Judge& J, const vector<string>& input )
+    {
+        const int oldFrozenWeek = J.frozenWeek;
+        vector<int> touched;
+        J.FreezeWeeks( oldFrozenWeek + 1, input, &touched );
+
+        auto t = touched.begin();
+        for( int i = 0; i < J.resourceN; i++ )
+        {
+            bool changed = false;
+            for( ; t != touched.end() && *t < ( i + 1 ) * J.week; t++ ) changed |= *t % J.week < oldFrozenWeek;
+            if( changed ) frozenLines[i].clear();
+
+            ostringstream ss;
+            for( int j = changed ? 0 : oldFrozenWeek; j < J.frozenWeek; j++ )
+                WriteLine( ss, J.GetFrozenLoadRate( i * J.week + j ), J.frozen->let_cnt[i * J.week + j] );
+            frozenLines[i] += ss.str();
+        }
+    }
+
+    // The load rate lines of all resource-weeks in the order of sequenceForward
+    void Write( ostream& os, const Judge& J, const Judge::RollingResult& r ) const
+    {
+        const int openWeekN = J.week - J.frozenWeek;
+        size_t t = 0;
+        for( int i = 0; i < J.resourceN; i++ )
+        {
+            if( t < r.touched.size() && r.touched[t] < ( i + 1 ) * J.week )
+            {
+                for( int j = 0; j < J.frozenWeek; j++ )
+                {
+                    const int index = i * J.week + j;
+                    if( t < r.touched.size() && r.touched[t] == index )
+                    {
+                        WriteLine( os, r.touchedLoadRate[t], r.touchedLetOpCount[t] );
+                        t++;
+                    }
+                    else
+                    {
+                        WriteLine( os, J.GetFrozenLoadRate( index ), J.frozen->let_cnt[index] );
+                    }
+                }
+            }
+            else
+            {
+                os << frozenLines[i];
+            }
+
+            for( int j = 0; j < openWeekN; j++ )
+                WriteLine( os, r.loadRate[i * openWeekN + j], r.letOpCount[i * openWeekN + j] );
+        }
+    }
+};
 
 void PrintErrorMessage( const string& msg )
 {
@@ -77,13 +156,18 @@ long long main_2( Judge& J )
         stringstream ss;
         ss << J.week << ' ' << J.resourceN << ' ' << J.resCalendarChangeLimitN << ' ' << J.reactiveN << endl;
         vis_out << J.resourceN << ' ' << J.week << ' ' << J.reactiveN << '\n';
+        if( metrics_out ) metrics_out << J.resourceN << ' ' << J.week << ' ' << J.reactiveN << '\n';
         for( auto& e : J.costTypeA )
         {
             ss << e.second << ' ' << J.costTypeB[e.first] << endl;
         }
         reactive_write( ss.str() );
+        if( transcript_out ) transcript_out << ss.str();
     }
 
+    RollingReply rollingReply;
+    rollingReply.frozenLines.assign( J.resourceN, "" );
+
     auto CheckInput = [&J] ( const vector<string>& input ) -> bool
     {
         for( const string& s : input )
@@ -110,47 +194,86 @@ long long main_2( Judge& J )
     for( int k = 0; k < J.reactiveN; k++ )
     {
         vector<string> input; // �Q���҂̏o�͎󂯎�� ... Receive output
-        for( int j = 0; j < J.resourceN; j++ )
         {
-            string s = reactive_read();
-            if( !s.empty() && s.back() == '\n' )
+            PerfScope scope( perf_profiler, PerfProfiler::PARSE );
+            ALLOCATION_PHASE( "parse" );
+            for( int j = 0; j < J.resourceN; j++ )
             {
-                s.pop_back();
-            }
-            vis_out << s << '\n';
+                string s = reactive_read();
+                if( !s.empty() && s.back() == '\n' )
+                {
+                    s.pop_back();
+                }
+                if( transcript_out ) transcript_out << s << '\n';
 
-            input.emplace_back( s );
-        }
+                // the frozen weeks are committed, whatever the solver sends for them
+                if( J.frozen.has_value() && s.size() == static_cast<size_t>( J.week ) * 2 ) s.replace( 0, J.frozenWeek * 2, J.frozenCalendar[j] );
+                vis_out << s << '\n';
 
-        if( !CheckInput( input ) )
-        {
-            return -1;
+                input.emplace_back( s );
+            }
+
+            if( !CheckInput( input ) )
+            {
+                return -1;
+            }
         }
 
         // �o�͂���J�����_�̐��� ... Generate calendar from output
         vector<vector<pair<int, int>>>calendar( J.resourceN );
-        long long cost = 0;
-        for( int i = 0; i < J.resourceN; i++ )
+        if( rollingInterval == 0 ) // the rolling simulation only builds the open weeks
         {
-            for( int j = 0; j < J.week; j++ )
+            PerfScope scope( perf_profiler, PerfProfiler::CALENDAR );
+            ALLOCATION_PHASE( "calendar" );
+            for( int i = 0; i < J.resourceN; i++ )
             {
-                int calendarTypeA = input[i][j * 2] - '1';
-                int calendarTypeB = input[i][j * 2 + 1] - '1';
-                Calendar.addCalendar( calendar[i], j, calendarTypeA, calendarTypeB );
+                for( int j = 0; j < J.week; j++ )
+                {
+                    int calendarTypeA = input[i][j * 2] - '1';
+                    int calendarTypeB = input[i][j * 2 + 1] - '1';
+                    Calendar.addCalendar( calendar[i], j, calendarTypeA, calendarTypeB );
+                }
+            }
 
-                cost += J.costTypeA[{i, calendarTypeA}] + J.costTypeB[{i, calendarTypeB}];
+            for( int j = 0; j < J.resourceN; j++ )
+            {
+                calendar[j].push_back( { 1'000'000'000, 2'000'000'000 } );
             }
         }
 
-        for( int j = 0; j < J.resourceN; j++ )
+        long long cost = 0;
+        if( rollingInterval == 0 )
         {
-            calendar[j].push_back( { 1'000'000'000, 2'000'000'000 } );
+            PerfScope scope( perf_profiler, PerfProfiler::COST );
+            ALLOCATION_PHASE( "cost" );
+            for( int i = 0; i < J.resourceN; i++ )
+            {
+                for( int j = 0; j < J.week; j++ )
+                {
+                    int calendarTypeA = input[i][j * 2] - '1';
+                    int calendarTypeB = input[i][j * 2 + 1] - '1';
+                    cost += J.costTypeA[{i, calendarTypeA}] + J.costTypeB[{i, calendarTypeB}];
+                }
+            }
         }
 
         // ����t�� ... assignation
-        auto [let, chLimVioCnt, loadRate, letOpCount] = J.sequenceForward( calendar, input );
+        Judge::RollingResult rolling;
+        auto [let, chLimVioCnt, loadRate, letOpCount] = [&] ()
+        {
+            PerfScope scope( perf_profiler, PerfProfiler::SIMULATE );
+            ALLOCATION_PHASE( "simulate" );
+            if( rollingInterval == 0 ) return J.sequenceForward( calendar, input );
+
+            if( !J.frozen.has_value() ) J.FreezeWeeks( 0, input );
+            rolling = J.sequenceForwardRolling( input );
+            cost = rolling.cost;
+            return make_tuple( rolling.let, rolling.changeLimitViolationCnt, map<pair<int, int>, double>(), map<pair<int, int>, int>() );
+        }();
 
         { // ���� ... input
+            PerfScope scope( perf_profiler, PerfProfiler::REPLY );
+            ALLOCATION_PHASE( "reply" );
             long long score = ( let + chLimVioCnt ) == 0 ? round( ( 10.0 - log10( static_cast<double>( cost / J.week ) ) ) * 1e9 ) : 0;
             bestScore = max( bestScore, score );
             stringstream ss;
@@ -159,9 +282,21 @@ long long main_2( Judge& J )
             {
                 ss << to_string( e.second ) << ' ' << to_string( letOpCount[e.first] ).substr( 0, 5 ) << endl;
             }
+            if( rollingInterval > 0 ) rollingReply.Write( ss, J, rolling );
             reactive_write( ss.str() );
+            if( transcript_out ) transcript_out << ss.str();
+
+            if( metrics_out ) metrics_out << k + 1 << ' ' << score << ' ' << cost / J.week << ' ' << ( ( let + chLimVioCnt ) == 0 ) << ' ' << let << ' ' << chLimVioCnt << '\n';
         }
 
+        if( rollingInterval > 0 && ( k + 1 ) % rollingInterval == 0 && J.frozenWeek < J.week )
+        {
+            PerfScope scope( perf_profiler, PerfProfiler::SIMULATE );
+            ALLOCATION_PHASE( "simulate" );
+            rollingReply.Freeze( J, input );
+        }
+
+        if( perf_profiler != nullptr ) perf_profiler->EndInteraction();
     }
     return bestScore;
 }
@@ -202,21 +337,137 @@ int main( int argc, char** argv )
 
 #else
 
+// key=value pairs of CPU time in milliseconds, max RSS in KiB and context switches
+string FormatUsage( const string& prefix, const struct rusage& usage )
+{
+    auto milliseconds = [] ( const timeval& time ) { return time.tv_sec * 1000.0 + time.tv_usec / 1000.0; };
+
+    stringstream ss;
+    ss << fixed << setprecision( 1 )
+       << prefix << "_user_ms=" << milliseconds( usage.ru_utime )
+       << ' ' << prefix << "_sys_ms=" << milliseconds( usage.ru_stime )
+       << ' ' << prefix << "_max_rss_kb=" << usage.ru_maxrss
+       << ' ' << prefix << "_voluntary_switches=" << usage.ru_nvcsw
+       << ' ' << prefix << "_involuntary_switches=" << usage.ru_nivcsw;
+    return ss.str();
+}
+
 int main( int argc, char** argv )
 {
     if( argc <= 1 )
     {
-        cerr << "usage: " << argv[0] << " <command>\n";
+        cerr << "usage: " << argv[0] << " <command> [-metrics metrics-file] [-trace trace-file] [-transcript transcript-file] [-perf perf-file] [-transport pipe|shm] [-rolling interactions]\n";
         return 0;
     }
 
-    Judge J = create_judge();
+    string traceFileName;
+    bool sharedMemory = false;
+    unique_ptr<PerfProfiler> profiler;
+    for( int i = 2; i < argc; i += 2 )
+    {
+        string option = argv[i];
+        if( i + 1 >= argc )
+        {
+            cerr << "missing value for option: " << option << '\n';
+            return 1;
+        }
+
+        if( option == "-metrics" )
+        {
+            metrics_out.open( argv[i + 1] );
+            if( !metrics_out )
+            {
+                cerr << "cannot open metrics file: " << argv[i + 1] << endl;
+                return 1;
+            }
+        }
+        else if( option == "-trace" )
+        {
+            traceFileName = argv[i + 1];
+        }
+        else if( option == "-perf" )
+        {
+            perf_out.open( argv[i + 1] );
+            if( !perf_out )
+            {
+                cerr << "cannot open perf file: " << argv[i + 1] << endl;
+                return 1;
+            }
+
+            profiler = make_unique<PerfProfiler>( &perf_out );
+            if( !profiler->Available() )
+            {
+                cerr << "perf_event_open is not available, -perf is ignored" << endl;
+                profiler.reset();
+            }
+            perf_profiler = profiler.get();
+        }
+        else if( option == "-transcript" )
+        {
+            transcript_out.open( argv[i + 1] );
+            if( !transcript_out )
+            {
+                cerr << "cannot open transcript file: " << argv[i + 1] << endl;
+                return 1;
+            }
+        }
+        else if( option == "-transport" )
+        {
+            string transport = argv[i + 1];
+            if( transport != "pipe" && transport != "shm" )
+            {
+                cerr << "unknown transport: " << transport << '\n';
+                return 1;
+            }
+            sharedMemory = transport == "shm";
+        }
+        else if( option == "-rolling" )
+        {
+            rollingInterval = atoi( argv[i + 1] );
+            if( rollingInterval <= 0 )
+            {
+                cerr << "invalid rolling interval: " << argv[i + 1] << '\n';
+                return 1;
+            }
+        }
+        else
+        {
+            cerr << "unknown option: " << option << '\n';
+            return 1;
+        }
+    }
+
+    // The solver's max RSS includes the judge image it is forked from, it is started while that is still small
+    if( reactive_start( argv[1], sharedMemory ) != 0 ) return 1;
+
+    Judge J;
+    {
+        PerfScope scope( perf_profiler, PerfProfiler::PARSE );
+        ALLOCATION_PHASE( "parse" );
+        J = create_judge();
+    }
+    if( perf_profiler != nullptr ) perf_profiler->EndInteraction(); // interaction 0 is the input file
+
+    if( !traceFileName.empty() )
+    {
+        if( !trace_out.Open( traceFileName, J.resourceN, J.week, J.operationN ) )
+        {
+            cerr << "cannot open trace file: " << traceFileName << endl;
+            return 1;
+        }
+        J.trace = &trace_out;
+    }
 
-    reactive_start( argv[1] );
     long long result = main_2( J );
     reactive_end();
     cout << result << '\n' << vis_out.str();
 
+    if( perf_profiler != nullptr ) perf_profiler->Report( cerr );
+
+    struct rusage judgeUsage;
+    getrusage( RUSAGE_SELF, &judgeUsage );
+    cerr << "Usage = " << FormatUsage( "solver", __reactive_usage ) << ' ' << FormatUsage( "judge", judgeUsage ) << endl;
+
     long long score = max( result, 0LL );
     cerr << "Score = " << score << endl;
     return 0;
@@ -1,7 +1,10 @@
 #pragma once
 
+#include <array>
 #include <cmath>
+#include <optional>
 #include "Problem.h"
+#include "trace.h"
 
 
 class Judge : public ProblemVar
@@ -12,6 +15,8 @@ private:
 public:
 
     int N;
+    GanttTraceWriter* trace = nullptr; // when set, sequenceForward writes every assigned interval to it
+
     explicit Judge()
     {}
 
@@ -22,33 +27,24 @@ public:
 
     // ����i�Tj �ɂ�����ғ����Ԃ̑��a�����߂�
     // Calculate the total working time of resource i week j
-    map<pair<int, int>, int> GetResourceTotalTime( std::vector<vector<pair<int, int>>> calendar )
+    vector<int> GetResourceTotalTime( const std::vector<vector<pair<int, int>>>& calendar ) // [resource * week + week]
     {
-        map<pair<int, int>, int> t;
+        vector<int> t( resourceN * week, 0 );
         for( int res = 0; auto & i:calendar )
         {
             for( auto& j : i )
             {
-                t[{res, GetWeek( j.first )}] += j.second - j.first;
+                const int w = GetWeek( j.first );
+                if( w < week ) t[res * week + w] += j.second - j.first;
             }
             res++;
         }
         return t;
     }
 
-
-    auto sequenceForward( vector<vector<pair<int, int>>> icalendar, vector<string> strCalendar ) // return {Number of let operations, Number of calendar change constraint violations, resource/week working ratio, resource/week Number of let operations}
+    // Calculate the number of calendar change limit violations
+    int GetChangeLimitViolationCnt( const vector<string>& strCalendar )
     {
-
-        std::vector<int>t3( resourceN, 0 );
-        std::vector<int>ridx( resourceN, 0 );
-        int END = week * 3600 * 24 * 7;
-
-        map<pair<int, int>, int> base = GetResourceTotalTime( icalendar );
-        map<pair<int, int>, int> used;
-        map<pair<int, int>, int> let_cnt;
-
-
         int changeLimitViolationCnt = 0;
         for( int i = 0; i < resourceN; i++ )
         {
@@ -61,152 +57,702 @@ public:
             }
             changeLimitViolationCnt += std::max( 0, cntCh - resCalendarChangeLimitN );
         }
+        return changeLimitViolationCnt;
+    }
 
-        for( int i = 0; i < resourceN; i++ )
-            for( int j = 0; j < week; j++ )
+
+    // Simulation state
+    struct SimulationState
+    {
+        std::vector<int> t3; // For each resource, production end time of the immediately preceding operation
+        std::vector<int> ridx; // calendar index of t3 for each resource
+        std::vector<int> used; // working time, [resource * week + week]
+        std::vector<int> let_cnt; // let operations, [resource * week + week]
+        int let = 0;
+        int opBegin = 0; // operations [0, opBegin) are already assigned
+        int inflatedChunkN = 0; // see AssignRoute, the error bound of sequenceForwardApprox assumes there are none
+
+        // When set, every write to used and let_cnt first records the old values, so that a simulation on top of the
+        // frozen state can be undone in time proportional to its own work (see sequenceForwardRolling)
+        struct JournalEntry
+        {
+            int index;
+            int used;
+            int let_cnt;
+        };
+        std::vector<JournalEntry>* journal = nullptr;
+
+        void Record( int index )
+        {
+            if( journal != nullptr ) journal->push_back( { index, used[index], let_cnt[index] } );
+        }
+    };
+
+    SimulationState GetInitialSimulationState()
+    {
+        SimulationState s;
+        s.t3.assign( resourceN, 0 );
+        s.ridx.assign( resourceN, 0 );
+        s.used.assign( resourceN * week, 0 );
+        s.let_cnt.assign( resourceN * week, 0 );
+        return s;
+    }
+
+    // Restore the entries written since the journal had mark entries
+    static void UndoJournal( SimulationState& s, size_t mark )
+    {
+        vector<SimulationState::JournalEntry>& journal = *s.journal;
+        for( size_t k = journal.size(); k-- > mark; )
+        {
+            s.used[journal[k].index] = journal[k].used;
+            s.let_cnt[journal[k].index] = journal[k].let_cnt;
+        }
+        journal.resize( mark );
+    }
+
+    // Assign operation op after the operations already in s, return the latest end time of its processes
+    int Assign( const Operation& op, const vector<vector<pair<int, int>>>& icalendar, SimulationState& s )
+    {
+        return ( this->*GetAssignKernel( this->itemList[op.itemNo].itemProcN ) )( op, icalendar, s );
+    }
+
+    // Assign kernels specialised by route length
+    // Most routes have 1 to a few processes. AssignRoute<N> handles routes of exactly N processes with the route in
+    // fixed-size arrays and a process loop of constant trip count, AssignRoute<0> handles any length. The kernel of
+    // every operation is looked up once per opList (see PrepareAssignKernels), so sequenceForward calls it directly.
+    static constexpr int MAX_SPECIALISED_ROUTE = 4;
+
+    using AssignKernel = int ( Judge::* )( const Operation&, const vector<vector<pair<int, int>>>&, SimulationState& );
+    vector<AssignKernel> assignKernels; // [operation]
+
+    // Per process intervals of the operation being assigned, reused between calls so assigning does not allocate
+    vector<vector<pair<int, int>>> assignScratch;
+    vector<int> letWeekScratch; // [resource * week + week]
+
+    static AssignKernel GetAssignKernel( int procN )
+    {
+        switch( procN )
+        {
+        case 1: return &Judge::AssignRoute<1>;
+        case 2: return &Judge::AssignRoute<2>;
+        case 3: return &Judge::AssignRoute<3>;
+        case 4: return &Judge::AssignRoute<4>;
+        default: return &Judge::AssignRoute<0>;
+        }
+    }
+
+    void PrepareAssignKernels()
+    {
+        if( assignKernels.size() == opList.size() ) return;
+
+        assignKernels.resize( opList.size() );
+        for( size_t i = 0; i < opList.size(); i++ )
+            assignKernels[i] = GetAssignKernel( this->itemList[opList[i].itemNo].itemProcN );
+    }
+
+    template<int N>
+    int AssignRoute( const Operation& op, const vector<vector<pair<int, int>>>& icalendar, SimulationState& s )
+    {
+        const Item& item = this->itemList[op.itemNo];
+        const int procN = N > 0 ? N : item.itemProcN;
+
+        std::array<int, ( N > 0 ? N : 1 )> fixedRes{}, fixedProd{};
+        if constexpr( N > 0 )
+        {
+            for( int i = 0; i < N; i++ )
             {
-                used[{i, j}] = 0;
-                let_cnt[{i, j}] = 0;
+                fixedRes[i] = item.proc[i];
+                fixedProd[i] = op.prodTime[i];
             }
+        }
+
+        if( static_cast<int>( assignScratch.size() ) < procN ) assignScratch.resize( procN );
+
+        // [( startTime, endTime ), ... ] of the previous process
+        static const vector<pair<int, int>> routeStart( 1, pair<int, int>( -1, 0 ) );
+        const vector<pair<int, int>>* lstAssigned = &routeStart;
+        int lstAssignedTotalTime = 1;
 
-        auto Assign = [this, END, &t3, &ridx, &used, &let_cnt, &icalendar] ( Operation& op )
+        for( int i = 0; i < procN; i++ )
         {
-            // [( startTime, endTime ), ... ]
-            std::vector<pair<int, int>> lstAssigned( 1, pair<int, int>( -1, 0 ) );
-            int lstAssignedTotalTime = 1;
+            const int res = N > 0 ? fixedRes[i] : item.proc[i];
+            const int prod = N > 0 ? fixedProd[i] : op.prodTime[i];
+            const vector<pair<int, int>>& cal = icalendar[res];
+            vector<pair<int, int>>& assigned = assignScratch[i];
+            assigned.clear();
 
-            std::vector<std::vector<pair<int, int>>> assignedList( this->itemList[op.itemNo].itemProcN, std::vector<pair<int, int>>() );
+            int remainProd = prod;
+            int tidx = s.ridx[res];
+            int t3 = s.t3[res];
 
-            for( int i = 0; i < this->itemList[op.itemNo].itemProcN; i++ )
+            for( auto [startTime, endTime] : *lstAssigned )
             {
-                const int res = this->itemList[op.itemNo].proc[i];
-                const int prod = op.prodTime[i];
-                int remainProd = prod;
-                int& tidx = ridx[res];
+                const int curProd = ( long long int ) ( endTime - startTime ) * prod / lstAssignedTotalTime;
+                int remainCurProd = curProd;
+                remainProd -= curProd;
 
-                for( auto [startTime, endTime] : lstAssigned )
-                {
-                    const int curProd = ( long long int ) ( endTime - startTime ) * prod / lstAssignedTotalTime;
-                    int remainCurProd = curProd;
-                    remainProd -= curProd;
+                int est = std::max( startTime, t3 );
+                while( cal[tidx].second <= est ) tidx++;
+                est = std::max( est, cal[tidx].first );
 
-                    int est = std::max( startTime, t3[res] );
-                    while( icalendar[res][tidx].second <= est ) tidx++;
-                    est = std::max( est, icalendar[res][tidx].first );
+                // �Ƃ肠�����O�l�߂����� ... First, front justification
+                // ��l�߂̏ꍇ�́C�O�l�߂���Ƃ��̍Ō�̏I��莞�Ԃ���J�n���Ԃ�T���B ... In the case of back justification, the start time is searched from the last end time when front justified.
+                while( remainCurProd )
+                {
+                    int curStartTime, curEndTime;
 
-                    // �Ƃ肠�����O�l�߂����� ... First, front justification
-                    // ��l�߂̏ꍇ�́C�O�l�߂���Ƃ��̍Ō�̏I��莞�Ԃ���J�n���Ԃ�T���B ... In the case of back justification, the start time is searched from the last end time when front justified.
-                    while( remainCurProd )
+                    if( endTime - est >= remainCurProd )
                     {
-                        int curStartTime, curEndTime;
-
-                        if( endTime - est >= remainCurProd )
-                        {
-                            curEndTime = endTime;
-                            curStartTime = curEndTime - remainCurProd;
-                        }
-                        else
-                        {
-                            curStartTime = est;
-                            curEndTime = curStartTime + remainCurProd;
-                        }
-
-                        if( curEndTime >= icalendar[res][tidx].second )
-                        {
-                            curEndTime = icalendar[res][tidx].second;
-                            tidx++;
-                            est = icalendar[res][tidx].first;
-                        }
-
-                        t3[res] = curEndTime;
-                        remainCurProd -= curEndTime - curStartTime;
-                        assignedList[i].push_back( make_pair( curStartTime, curEndTime ) );
+                        curEndTime = endTime;
+                        curStartTime = curEndTime - remainCurProd;
+                    }
+                    else
+                    {
+                        curStartTime = est;
+                        curEndTime = curStartTime + remainCurProd;
                     }
-                }
 
-                while( remainProd )
-                {
-                    int est = t3[res];
-                    int curStartTime = est, curEndTime = est + remainProd;
-                    if( curEndTime >= icalendar[res][tidx].second )
+                    if( curEndTime >= cal[tidx].second )
                     {
-                        curEndTime = icalendar[res][tidx].second;
+                        // a chunk that starts after the working interval ends gets a negative length, which adds
+                        // work to the process
+                        if( curStartTime > cal[tidx].second ) s.inflatedChunkN++;
+                        curEndTime = cal[tidx].second;
                         tidx++;
+                        est = cal[tidx].first;
                     }
 
-                    t3[res] = curEndTime;
-                    remainProd -= curEndTime - curStartTime;
-                    assignedList[i].push_back( make_pair( curStartTime, curEndTime ) );
+                    t3 = curEndTime;
+                    remainCurProd -= curEndTime - curStartTime;
+                    assigned.emplace_back( curStartTime, curEndTime );
                 }
+            }
 
-                // �I��莞�Ԃ���t�Z���� ... calculate backwards from the end time
-                int endTime = assignedList[i].back().second;
-                int bidx = tidx;
-                remainProd = prod;
-                assignedList[i].clear();
-
-                while( remainProd )
+            while( remainProd )
+            {
+                int curStartTime = t3, curEndTime = t3 + remainProd;
+                if( curEndTime >= cal[tidx].second )
                 {
-                    while( icalendar[res][bidx].first >= endTime ) bidx--;
-                    int curStartTime = icalendar[res][bidx].first;
-                    int curEndTime = std::min( icalendar[res][bidx].second, endTime );
+                    curEndTime = cal[tidx].second;
+                    tidx++;
+                }
 
-                    if( curEndTime - curStartTime > remainProd ) curStartTime = curEndTime - remainProd;
-                    bidx--;
+                t3 = curEndTime;
+                remainProd -= curEndTime - curStartTime;
+                assigned.emplace_back( curStartTime, curEndTime );
+            }
 
-                    remainProd -= curEndTime - curStartTime;
-                    assignedList[i].push_back( make_pair( curStartTime, curEndTime ) );
+            s.ridx[res] = tidx;
+            s.t3[res] = t3;
+
+            // �I��莞�Ԃ���t�Z���� ... calculate backwards from the end time
+            int endTime = assigned.back().second;
+            int bidx = tidx;
+            remainProd = prod;
+            assigned.clear();
+
+            while( remainProd )
+            {
+                while( cal[bidx].first >= endTime ) bidx--;
+                int curStartTime = cal[bidx].first;
+                int curEndTime = std::min( cal[bidx].second, endTime );
+
+                if( curEndTime - curStartTime > remainProd ) curStartTime = curEndTime - remainProd;
+                bidx--;
+
+                remainProd -= curEndTime - curStartTime;
+                assigned.emplace_back( curStartTime, curEndTime );
+            }
+
+            std::reverse( assigned.begin(), assigned.end() );
+            for( auto [startTime, endTime] : assigned )
+            {
+                int curWeek = GetWeek( startTime );
+                if( curWeek < week )
+                {
+                    s.Record( res * week + curWeek );
+                    s.used[res * week + curWeek] += endTime - startTime;
                 }
+            }
+
+            lstAssigned = &assigned;
+            lstAssignedTotalTime = prod;
+        }
 
-                std::reverse( assignedList[i].begin(), assignedList[i].end() );
-                for( auto [startTime, endTime] : assignedList[i] )
+        bool let = lstAssigned->back().second > op.let;
+
+        if( let ) // �[���x���Ƃ̏������Ԃ��܂ޏT���`�F�b�N ... Check week including processing time for let operation
+        {
+            letWeekScratch.clear();
+            for( int i = 0; i < procN; i++ )
+            {
+                const int res = N > 0 ? fixedRes[i] : item.proc[i];
+                for( auto [startTime, endTime] : assignScratch[i] )
                 {
                     int curWeek = GetWeek( startTime );
-                    if( curWeek < week ) used[make_pair( res, curWeek )] += endTime - startTime;
+                    if( curWeek < week ) letWeekScratch.push_back( res * week + curWeek );
                 }
+            }
 
-                lstAssigned = assignedList[i];
-                lstAssignedTotalTime = prod;
+            std::sort( letWeekScratch.begin(), letWeekScratch.end() );
+            letWeekScratch.erase( std::unique( letWeekScratch.begin(), letWeekScratch.end() ), letWeekScratch.end() );
+            for( int p : letWeekScratch )
+            {
+                s.Record( p );
+                s.let_cnt[p]++;
             }
 
-            bool let = lstAssigned.back().second > op.let;
+            s.let++;
+        }
 
-            if( let ) // �[���x���Ƃ̏������Ԃ��܂ޏT���`�F�b�N ... Check week including processing time for let operation
+        if( this->trace != nullptr )
+        {
+            for( int i = 0; i < procN; i++ )
             {
-                set<pair<int, int>> se;
-                for( int i = 0; const vector<pair<int, int>>&vec : assignedList )
-                {
-                    int res = this->itemList[op.itemNo].proc[i];
+                for( auto [startTime, endTime] : assignScratch[i] )
+                    this->trace->Add( op.opNo, i, item.proc[i], startTime, endTime, let );
+            }
+        }
 
-                    for( auto [startTime, endTime] : vec )
-                    {
-                        int curWeek = GetWeek( startTime );
-                        if( curWeek < week ) se.insert( make_pair( res, curWeek ) );
-                    }
+        int opEndTime = 0;
+        for( int i = 0; i < procN; i++ )
+            opEndTime = std::max( opEndTime, assignScratch[i].back().second );
+        return opEndTime;
+    }
 
-                    i++;
-                }
 
-                for( pair<int, int> p : se ) let_cnt[p]++;
-            }
-            //cerr << prev_t3 << ' ' << op.let << endl;
-            return let;
-        };
-        int let = 0;
+    auto sequenceForward( const vector<vector<pair<int, int>>>& icalendar, const vector<string>& strCalendar ) // return {Number of let operations, Number of calendar change constraint violations, resource/week working ratio, resource/week Number of let operations}
+    {
+        const vector<int> base = GetResourceTotalTime( icalendar );
+
+        int changeLimitViolationCnt = GetChangeLimitViolationCnt( strCalendar );
+
+        SimulationState s = GetInitialSimulationState();
+
+        if( trace != nullptr ) trace->BeginInteraction();
+
+        PrepareAssignKernels();
         for( int i = 0; i < operationN; i++ )
         {
-            bool letFlag = Assign( opList[i] );
-            let += letFlag == true ? 1 : 0;
+            ( this->*assignKernels[i] )( opList[i], icalendar, s );
         }
 
-        //assert( used.size() == base.size() );
+        if( trace != nullptr ) trace->EndInteraction();
+
         map<pair<int, int>, double>loadRate;
-        for( auto& e : used )
+        map<pair<int, int>, int> let_cnt;
+        for( int i = 0; i < resourceN; i++ )
+            for( int j = 0; j < week; j++ )
+            {
+                loadRate.emplace_hint( loadRate.end(), make_pair( i, j ), static_cast<double>( s.used[i * week + j] ) / (double)max( 1, base[i * week + j] ) );
+                let_cnt.emplace_hint( let_cnt.end(), make_pair( i, j ), s.let_cnt[i * week + j] );
+            }
+        return make_tuple( s.let, changeLimitViolationCnt, loadRate, let_cnt );
+    }
+
+    // Rolling horizon
+    // Weeks [0, frozenWeek) are committed. The operations that the frozen calendar completes before the freeze point
+    // are assigned once and kept in `frozen`, together with the working time, pattern cost and calendar changes of the
+    // frozen weeks. sequenceForwardRolling simulates the remaining operations on top of `frozen` and undoes its writes
+    // through the journal afterwards, so its work is proportional to the open part of the horizon. rollingCalendar keeps
+    // the intervals of the frozen weeks, only the open weeks are appended again per call. A trace has to be set before
+    // the first FreezeWeeks, the intervals of the committed operations are kept in frozenTrace and repeated in every
+    // block, so that a block has the same rows as the one of a full simulation.
+    std::optional<SimulationState> frozen;
+    int frozenWeek = 0;
+    vector<string> frozenCalendar;
+    vector<vector<pair<int, int>>> rollingCalendar; // [resource], the frozen weeks followed by the open weeks
+    vector<int> frozenIntervalN; // [resource], number of intervals of the frozen weeks in rollingCalendar
+    vector<int> frozenBase; // working time of the frozen weeks, [resource * week + week]
+    vector<int> frozenChangeN; // [resource], calendar changes among the frozen weeks
+    long long frozenCost = 0; // pattern cost of the frozen weeks
+    GanttTraceRows frozenTrace;
+    vector<SimulationState::JournalEntry> rollingJournal;
+
+    // rollingCalendar = the frozen intervals followed by the open weeks of strCalendar
+    void SetRollingCalendar( const vector<string>& strCalendar )
+    {
+        for( int i = 0; i < resourceN; i++ )
+        {
+            rollingCalendar[i].resize( frozenIntervalN[i] );
+            for( int j = frozenWeek; j < week; j++ )
+                Calendar.addCalendar( rollingCalendar[i], j, strCalendar[i][j * 2] - '1', strCalendar[i][j * 2 + 1] - '1' );
+            rollingCalendar[i].push_back( { 1'000'000'000, 2'000'000'000 } );
+        }
+    }
+
+    // Commit weeks [0, newFrozenWeek) with the calendar of strCalendar, whose already frozen weeks are ignored. Returns
+    // the number of newly committed operations. touched, if given, receives the resource-weeks [resource * week + week]
+    // whose working time or let count the committed operations changed, sorted.
+    int FreezeWeeks( int newFrozenWeek, const vector<string>& strCalendar, vector<int>* touched = nullptr )
+    {
+        assert( frozenWeek <= newFrozenWeek && newFrozenWeek <= week );
+        if( !frozen.has_value() )
         {
-            if( e.first.second == week ) continue;
-            loadRate[e.first] = static_cast<double>( e.second ) / (double)max( 1, base[e.first] );
+            frozen = GetInitialSimulationState();
+            rollingCalendar.assign( resourceN, {} );
+            frozenIntervalN.assign( resourceN, 0 );
+            frozenBase.assign( resourceN * week, 0 );
+            frozenChangeN.assign( resourceN, 0 );
+            frozenCalendar.assign( resourceN, "" );
+            frozenCost = 0;
+            frozenTrace.Clear();
         }
-        return make_tuple( let, changeLimitViolationCnt, loadRate, let_cnt );
+        SetRollingCalendar( strCalendar );
+
+        // The calendar of a week reaches until 4:00 of the next week
+        const int freezeTime = newFrozenWeek * WEEK + 4 * HOUR;
+
+        SimulationState& s = *frozen;
+        const int opBegin = s.opBegin;
+        rollingJournal.clear();
+        s.journal = &rollingJournal;
+        if( trace != nullptr ) trace->BeginInteraction();
+
+        // Only a prefix of the operations can be committed, every later operation depends on the open calendar. The
+        // first operation that ends after the freeze point is undone again.
+        PrepareAssignKernels();
+        vector<std::array<int, 3>> route; // ( resource, t3, ridx ) before the operation
+        while( frozenWeek < newFrozenWeek && s.opBegin < operationN )
+        {
+            const Operation& op = opList[s.opBegin];
+            const size_t journalMark = rollingJournal.size();
+            const size_t traceMark = trace != nullptr ? trace->Rows().Size() : 0;
+            const int let = s.let, inflatedChunkN = s.inflatedChunkN;
+            route.clear();
+            for( int res : itemList[op.itemNo].proc ) route.push_back( { res, s.t3[res], s.ridx[res] } );
+
+            if( ( this->*assignKernels[s.opBegin] )( op, rollingCalendar, s ) <= freezeTime )
+            {
+                s.opBegin++;
+                continue;
+            }
+
+            UndoJournal( s, journalMark );
+            for( auto e = route.rbegin(); e != route.rend(); e++ ) // the first entry of a resource is its old state
+            {
+                s.t3[( *e )[0]] = ( *e )[1];
+                s.ridx[( *e )[0]] = ( *e )[2];
+            }
+            s.let = let;
+            s.inflatedChunkN = inflatedChunkN;
+            if( trace != nullptr ) trace->Rows().Truncate( traceMark );
+            break;
+        }
+        s.journal = nullptr;
+
+        if( trace != nullptr )
+        {
+            frozenTrace.Append( trace->Rows() );
+            trace->BeginInteraction();
+        }
+
+        if( touched != nullptr )
+        {
+            touched->clear();
+            for( const auto& e : rollingJournal ) touched->push_back( e.index );
+            std::sort( touched->begin(), touched->end() );
+            touched->erase( std::unique( touched->begin(), touched->end() ), touched->end() );
+        }
+
+        // working time, pattern cost and calendar changes of the newly frozen weeks
+        for( int i = 0; i < resourceN; i++ )
+        {
+            int interval = frozenIntervalN[i];
+            for( int j = frozenWeek; j < newFrozenWeek; j++ )
+            {
+                const int typeA = strCalendar[i][j * 2] - '1', typeB = strCalendar[i][j * 2 + 1] - '1';
+                const int intervalN = static_cast<int>( 5 * Calendar.pattern[typeA].size() + 2 * Calendar.pattern[typeB].size() );
+                for( int k = 0; k < intervalN; k++, interval++ )
+                    frozenBase[i * week + j] += rollingCalendar[i][interval].second - rollingCalendar[i][interval].first;
+                frozenCost += costTypeA[{i, typeA}] + costTypeB[{i, typeB}];
+            }
+            frozenIntervalN[i] = interval;
+
+            // the change between half-weeks c and c + 2 is fixed once both are frozen
+            frozenCalendar[i].append( strCalendar[i], frozenWeek * 2, ( newFrozenWeek - frozenWeek ) * 2 );
+            for( int c = max( 0, frozenWeek * 2 - 2 ); c < newFrozenWeek * 2 - 2; c++ )
+                if( frozenCalendar[i][c] != frozenCalendar[i][c + 2] ) frozenChangeN[i]++;
+        }
+        frozenWeek = newFrozenWeek;
+
+        return s.opBegin - opBegin;
+    }
+
+    // load rate of a frozen resource-week [resource * week + week] from the committed operations only
+    double GetFrozenLoadRate( int index ) const
+    {
+        return static_cast<double>( frozen->used[index] ) / (double)max( 1, frozenBase[index] );
+    }
+
+    struct RollingResult
+    {
+        int let = 0;
+        int changeLimitViolationCnt = 0;
+        long long cost = 0; // pattern cost of the whole calendar
+        vector<double> loadRate; // open weeks, [resource * ( week - frozenWeek ) + week - frozenWeek]
+        vector<int> letOpCount;
+        vector<int> touched; // frozen resource-weeks [resource * week + week] the open operations worked in, sorted
+        vector<double> touchedLoadRate;
+        vector<int> touchedLetOpCount;
+    };
+
+    // Simulate the open operations on top of the frozen state with the open weeks of strCalendar, its frozen weeks are
+    // ignored. The values of the frozen weeks that are not in touched are those of the committed operations.
+    RollingResult sequenceForwardRolling( const vector<string>& strCalendar )
+    {
+        assert( frozen.has_value() );
+        SetRollingCalendar( strCalendar );
+
+        RollingResult r;
+        r.cost = frozenCost;
+        const int openWeekN = week - frozenWeek;
+        vector<int> base( resourceN * openWeekN );
+        for( int i = 0; i < resourceN; i++ )
+        {
+            int changeN = frozenChangeN[i];
+            for( int c = max( 0, frozenWeek * 2 - 2 ); c < week * 2 - 2; c++ )
+                if( ( c < frozenWeek * 2 ? frozenCalendar[i][c] : strCalendar[i][c] ) != strCalendar[i][c + 2] ) changeN++;
+            r.changeLimitViolationCnt += std::max( 0, changeN - resCalendarChangeLimitN );
+
+            for( int j = frozenWeek; j < week; j++ )
+            {
+                const int typeA = strCalendar[i][j * 2] - '1', typeB = strCalendar[i][j * 2 + 1] - '1';
+                r.cost += costTypeA[{i, typeA}] + costTypeB[{i, typeB}];
+                base[i * openWeekN + j - frozenWeek] = ( 5 * Calendar.totalTime[typeA] + 2 * Calendar.totalTime[typeB] ) * HOUR;
+            }
+        }
+
+        SimulationState& s = *frozen;
+        const vector<int> t3 = s.t3, ridx = s.ridx;
+        const int let = s.let, inflatedChunkN = s.inflatedChunkN;
+        rollingJournal.clear();
+        s.journal = &rollingJournal;
+
+        if( trace != nullptr )
+        {
+            trace->BeginInteraction();
+            trace->Rows().Append( frozenTrace );
+        }
+
+        PrepareAssignKernels();
+        for( int i = s.opBegin; i < operationN; i++ )
+        {
+            ( this->*assignKernels[i] )( opList[i], rollingCalendar, s );
+        }
+
+        if( trace != nullptr ) trace->EndInteraction();
+
+        r.let = s.let;
+        r.loadRate.resize( resourceN * openWeekN );
+        r.letOpCount.resize( resourceN * openWeekN );
+        for( int i = 0; i < resourceN; i++ )
+            for( int j = frozenWeek; j < week; j++ )
+            {
+                const int o = i * openWeekN + j - frozenWeek;
+                r.loadRate[o] = static_cast<double>( s.used[i * week + j] ) / (double)max( 1, base[o] );
+                r.letOpCount[o] = s.let_cnt[i * week + j];
+            }
+
+        for( const auto& e : rollingJournal )
+            if( e.index % week < frozenWeek ) r.touched.push_back( e.index );
+        std::sort( r.touched.begin(), r.touched.end() );
+        r.touched.erase( std::unique( r.touched.begin(), r.touched.end() ), r.touched.end() );
+        for( int index : r.touched )
+        {
+            r.touchedLoadRate.push_back( static_cast<double>( s.used[index] ) / (double)max( 1, frozenBase[index] ) );
+            r.touchedLetOpCount.push_back( s.let_cnt[index] );
+        }
+
+        UndoJournal( s, 0 );
+        s.journal = nullptr;
+        s.t3 = t3;
+        s.ridx = ridx;
+        s.let = let;
+        s.inflatedChunkN = inflatedChunkN;
+        return r;
+    }
+
+    // Extend the horizon by newWeeks weeks and add operations to the end of opList
+    void AppendHorizon( int newWeeks, const vector<Operation>& newOps )
+    {
+        // the per resource-week vectors are laid out by week
+        auto Widen = [this, newWeeks] ( vector<int>& v )
+        {
+            vector<int> w( resourceN * ( week + newWeeks ), 0 );
+            for( int i = 0; i < resourceN; i++ )
+                std::copy( v.begin() + i * week, v.begin() + ( i + 1 ) * week, w.begin() + i * ( week + newWeeks ) );
+            v.swap( w );
+        };
+        if( frozen.has_value() )
+        {
+            Widen( frozen->used );
+            Widen( frozen->let_cnt );
+            Widen( frozenBase );
+        }
+        week += newWeeks;
+
+        for( Operation op : newOps )
+        {
+            assert( 0 <= op.itemNo && op.itemNo < itemN );
+            assert( op.prodTime.size() == itemList[op.itemNo].proc.size() );
+            op.opNo = operationN++;
+            opList.emplace_back( op );
+        }
+        macroList.clear();
+    }
+
+
+    // Approximate evaluation
+    // Consecutive operations that share a route are merged into one macro-operation whose production time per process
+    // is the sum over its members. Macro-operations are scheduled through their route without the per-interval
+    // splitting of Assign, which makes the simulation much cheaper for screening candidates. Two frontiers are kept:
+    // a pessimistic one where a process starts after the previous process has ended, and an optimistic one where it
+    // may start together with the previous process. They enclose the exact schedule, which bounds the lateness error,
+    // unless Assign inflates the work of a process (SimulationState::inflatedChunkN), then the exact schedule can be
+    // later than the pessimistic frontier.
+    struct MacroOperation
+    {
+        int itemNo;
+        int first, last; // opList[first, last)
+        std::vector<int> prodTime; // total production time of the i-th process
+    };
+
+    std::vector<MacroOperation> macroList;
+
+    void BuildMacroOperations( int maxMacroSize = 16 )
+    {
+        macroList.clear();
+        for( int first = 0; first < operationN; )
+        {
+            const Item& item = itemList[opList[first].itemNo];
+            MacroOperation m{ item.itemNo, first, first, std::vector<int>( item.itemProcN, 0 ) };
+
+            // On a route that visits a resource twice the members interleave their processes on it, which a
+            // macro-operation can not bound, so such operations stay single
+            std::vector<int> route = item.proc;
+            std::sort( route.begin(), route.end() );
+            const int macroSize = std::adjacent_find( route.begin(), route.end() ) == route.end() ? maxMacroSize : 1;
+
+            while( m.last < operationN && m.last - m.first < macroSize && itemList[opList[m.last].itemNo].proc == item.proc )
+            {
+                for( int i = 0; i < item.itemProcN; i++ )
+                    m.prodTime[i] += opList[m.last].prodTime[i];
+                m.last++;
+            }
+
+            first = m.last;
+            macroList.emplace_back( m );
+        }
+    }
+
+    // time at which `work` seconds started no earlier than `time` are finished, idx is the calendar index hint
+    static int AdvanceWorkTime( const vector<pair<int, int>>& calendar, int& idx, int time, int work )
+    {
+        while( calendar[idx].second <= time ) idx++;
+        time = std::max( time, calendar[idx].first );
+        while( work > calendar[idx].second - time )
+        {
+            work -= calendar[idx].second - time;
+            idx++;
+            time = calendar[idx].first;
+        }
+        return time + work;
+    }
+
+    // return {Number of possibly let operations, error bound of the number of let operations, Number of calendar change constraint violations, resource/week working ratio, resource/week Number of let operations}
+    // The number of let operations of sequenceForward lies in [let - error bound, let] when no chunk is inflated, and is
+    // at least let - error bound in any case. Loads and let counts are taken from the pessimistic frontier.
+    auto sequenceForwardApprox( const vector<vector<pair<int, int>>>& icalendar, const vector<string>& strCalendar )
+    {
+        if( macroList.empty() || macroList.back().last != operationN ) BuildMacroOperations();
+
+        std::vector<int>t3Hi( resourceN, 0 ), ridxHi( resourceN, 0 );
+        std::vector<int>t3Lo( resourceN, 0 ), ridxLo( resourceN, 0 );
+        std::vector<int>used( resourceN * week, 0 );
+        std::vector<int>letOps( resourceN * week, 0 );
+
+        int changeLimitViolationCnt = GetChangeLimitViolationCnt( strCalendar );
+
+        int letMax = 0, letMin = 0;
+        std::vector<int> touched;
+
+        for( const MacroOperation& m : macroList )
+        {
+            const std::vector<int>& proc = itemList[m.itemNo].proc;
+            int hiStartTime = 0, hiEndTime = 0;
+            int loStartTime = 0, loIdx = 0;
+            touched.clear();
+
+            for( int i = 0; i < (int)proc.size(); i++ )
+            {
+                const int res = proc[i];
+                const vector<pair<int, int>>& cal = icalendar[res];
+
+                hiStartTime = std::max( t3Hi[res], hiEndTime );
+                hiEndTime = AdvanceWorkTime( cal, ridxHi[res], hiStartTime, m.prodTime[i] );
+                t3Hi[res] = hiEndTime;
+
+                // calculate backwards from the end time
+                int bidx = ridxHi[res];
+                int remainProd = m.prodTime[i];
+                while( remainProd )
+                {
+                    while( cal[bidx].first >= hiEndTime ) bidx--;
+                    int curStartTime = cal[bidx].first;
+                    int curEndTime = std::min( cal[bidx].second, hiEndTime );
+                    if( curEndTime - curStartTime > remainProd ) curStartTime = curEndTime - remainProd;
+                    bidx--;
+
+                    remainProd -= curEndTime - curStartTime;
+
+                    int curWeek = GetWeek( curStartTime );
+                    if( curWeek < week )
+                    {
+                        used[res * week + curWeek] += curEndTime - curStartTime;
+                        touched.push_back( res * week + curWeek );
+                    }
+                }
+
+                int est = std::max( t3Lo[res], loStartTime );
+                loIdx = ridxLo[res];
+                while( cal[loIdx].second <= est ) loIdx++;
+                loStartTime = std::max( est, cal[loIdx].first );
+                // not bounded by the end of the previous process, Assign's rounding can finish a process before it
+                t3Lo[res] = AdvanceWorkTime( cal, ridxLo[res], loStartTime, m.prodTime[i] );
+            }
+
+            // Every member ends no later than the pessimistic macro-operation. Member k can not end before the last
+            // process has worked off the last process times of members first..k on the optimistic frontier.
+            const vector<pair<int, int>>& cal = icalendar[proc.back()];
+            int lowerEndTime = loStartTime;
+            int possibleLet = 0;
+            for( int k = m.first; k < m.last; k++ )
+            {
+                lowerEndTime = AdvanceWorkTime( cal, loIdx, lowerEndTime, opList[k].prodTime.back() );
+                if( lowerEndTime > opList[k].let ) letMin++;
+                if( hiEndTime > opList[k].let ) possibleLet++;
+            }
+            letMax += possibleLet;
+
+            if( possibleLet )
+            {
+                std::sort( touched.begin(), touched.end() );
+                touched.erase( std::unique( touched.begin(), touched.end() ), touched.end() );
+                for( int p : touched ) letOps[p] += possibleLet;
+            }
+        }
+
+        const vector<int> base = GetResourceTotalTime( icalendar );
+        map<pair<int, int>, double>loadRate;
+        map<pair<int, int>, int> let_cnt;
+        for( int i = 0; i < resourceN; i++ )
+            for( int j = 0; j < week; j++ )
+            {
+                loadRate[{i, j}] = static_cast<double>( used[i * week + j] ) / (double)max( 1, base[i * week + j] );
+                let_cnt[{i, j}] = letOps[i * week + j];
+            }
+        return make_tuple( letMax, letMax - letMin, changeLimitViolationCnt, loadRate, let_cnt );
     }
 
 
@@ -0,0 +1,412 @@
+// consistency checks of the judge's simulation variants against sequenceForward, run by ctest
+//
+// The instances are made by the generator in-process and written next to the given prefix. Every instance is
+// evaluated with a few calendars: all 9s, all 5s and random patterns.
+// The multi check runs solvers through judge and judge_multi and compares their scores, and checks that judge_multi's
+// timeout ends a solver that never answers.
+
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "judge.h"
+#include "gen.h"
+
+
+struct CalendarInput
+{
+    vector<string> strCalendar;
+    vector<vector<pair<int, int>>> icalendar;
+};
+
+CalendarInput CreateCalendar( const Judge& J, const vector<string>& strCalendar )
+{
+    CalendarInput c{ strCalendar, vector<vector<pair<int, int>>>( J.resourceN ) };
+    for( int i = 0; i < J.resourceN; i++ )
+    {
+        for( int j = 0; j < J.week; j++ )
+            Calendar.addCalendar( c.icalendar[i], j, strCalendar[i][j * 2] - '1', strCalendar[i][j * 2 + 1] - '1' );
+        c.icalendar[i].push_back( { 1'000'000'000, 2'000'000'000 } );
+    }
+    return c;
+}
+
+vector<CalendarInput> CreateCalendars( const Judge& J, int calendarN, unsigned int seed )
+{
+    std::mt19937 random( seed );
+    vector<CalendarInput> calendars;
+    for( int k = 0; k < calendarN; k++ )
+    {
+        vector<string> strCalendar( J.resourceN );
+        for( int i = 0; i < J.resourceN; i++ )
+        {
+            for( int j = 0; j < J.week * 2; j++ )
+            {
+                if( k == 0 ) strCalendar[i] += '9';
+                else if( k == 1 ) strCalendar[i] += '5';
+                else strCalendar[i] += static_cast<char>( '1' + random() % 9 );
+            }
+        }
+        calendars.push_back( CreateCalendar( J, strCalendar ) );
+    }
+    return calendars;
+}
+
+string GenerateInstance( const string& prefix, int seed, const string& options = "" )
+{
+    Generator G;
+    G.Generate( seed, "-seed " + to_string( seed ) + options, prefix );
+    G.Output();
+    return G.GetOutputFileName();
+}
+
+bool LoadInstance( Judge& J, const string& prefix, int seed )
+{
+    const string fileName = GenerateInstance( prefix, seed );
+    ifstream in( fileName );
+    if( !in )
+    {
+        cerr << "cannot open generated input file " << fileName << endl;
+        return false;
+    }
+    J.Input( in );
+    return true;
+}
+
+// The number of let operations of sequenceForward lies in [letMax - error bound, letMax] of sequenceForwardApprox. Only
+// the lower end holds for simulations in which Assign inflated a chunk, those are counted separately.
+bool CheckApprox( Judge& J, const vector<CalendarInput>& calendars, int seed, int& inflatedN )
+{
+    bool ok = true;
+    for( size_t k = 0; k < calendars.size(); k++ )
+    {
+        const CalendarInput& c = calendars[k];
+
+        Judge::SimulationState s = J.GetInitialSimulationState();
+        for( const auto& op : J.opList ) J.Assign( op, c.icalendar, s );
+
+        const auto [letMax, errorBound, chLimVioCnt, loadRate, letOpCount] = J.sequenceForwardApprox( c.icalendar, c.strCalendar );
+        if( s.let < letMax - errorBound || ( s.let > letMax && s.inflatedChunkN == 0 ) )
+        {
+            cerr << "seed " << seed << ", calendar " << k << ": let " << s.let << " is outside of [" << letMax - errorBound << ", " << letMax << "]" << endl;
+            ok = false;
+        }
+        if( s.inflatedChunkN > 0 ) inflatedN++;
+    }
+    return ok;
+}
+
+// The open weeks of strCalendar after the frozen weeks of J
+vector<string> GetEffectiveCalendar( const Judge& J, vector<string> strCalendar )
+{
+    for( int i = 0; J.frozen.has_value() && i < J.resourceN; i++ ) strCalendar[i].replace( 0, J.frozenWeek * 2, J.frozenCalendar[i] );
+    return strCalendar;
+}
+
+// A rolling simulation of J gives the same results as sequenceForward of R on the effective calendar
+bool CompareRolling( const Judge& J, Judge& R, const Judge::RollingResult& r, const vector<string>& strCalendar, const string& what )
+{
+    const CalendarInput c = CreateCalendar( R, GetEffectiveCalendar( J, strCalendar ) );
+    const auto [let, chLimVioCnt, loadRate, letOpCount] = R.sequenceForward( c.icalendar, c.strCalendar );
+
+    long long cost = 0;
+    for( int i = 0; i < R.resourceN; i++ )
+        for( int j = 0; j < R.week; j++ )
+            cost += R.costTypeA[{i, c.strCalendar[i][j * 2] - '1'}] + R.costTypeB[{i, c.strCalendar[i][j * 2 + 1] - '1'}];
+
+    bool ok = r.let == let && r.changeLimitViolationCnt == chLimVioCnt && r.cost == cost;
+    const int openWeekN = J.week - J.frozenWeek;
+    size_t t = 0;
+    for( int i = 0; i < J.resourceN; i++ )
+    {
+        for( int j = 0; j < J.week; j++ )
+        {
+            const int index = i * J.week + j;
+            double rate;
+            int count;
+            if( j >= J.frozenWeek )
+            {
+                rate = r.loadRate[i * openWeekN + j - J.frozenWeek];
+                count = r.letOpCount[i * openWeekN + j - J.frozenWeek];
+            }
+            else if( t < r.touched.size() && r.touched[t] == index )
+            {
+                rate = r.touchedLoadRate[t];
+                count = r.touchedLetOpCount[t];
+                t++;
+            }
+            else
+            {
+                rate = J.GetFrozenLoadRate( index );
+                count = J.frozen->let_cnt[index];
+            }
+            if( rate != loadRate.at( { i, j } ) || count != letOpCount.at( { i, j } ) ) ok = false;
+        }
+    }
+
+    if( !ok ) cerr << what << ": the rolling simulation differs from sequenceForward" << endl;
+    return ok;
+}
+
+bool IsSameFile( const string& a, const string& b )
+{
+    ifstream fa( a, ios::binary ), fb( b, ios::binary );
+    return fa && fb && string( istreambuf_iterator<char>( fa ), {} ) == string( istreambuf_iterator<char>( fb ), {} );
+}
+
+// One week is frozen per interaction, every interaction and the trace files have to match a full simulation
+bool CheckRolling( const Judge& instance, const vector<CalendarInput>& calendars, int seed, const string& prefix )
+{
+    const string rollingTraceName = prefix + to_string( seed ) + ".rolling.trace", fullTraceName = prefix + to_string( seed ) + ".full.trace";
+    bool ok = true;
+    {
+        Judge J = instance, R = instance;
+        GanttTraceWriter rollingTrace, fullTrace;
+        if( !rollingTrace.Open( rollingTraceName, J.resourceN, J.week, J.operationN ) || !fullTrace.Open( fullTraceName, R.resourceN, R.week, R.operationN ) )
+        {
+            cerr << "cannot open trace file " << rollingTraceName << endl;
+            return false;
+        }
+        J.trace = &rollingTrace;
+        R.trace = &fullTrace;
+
+        for( int k = 0; k <= J.week; k++ )
+        {
+            const vector<string>& input = calendars[k % calendars.size()].strCalendar;
+            if( !J.frozen.has_value() ) J.FreezeWeeks( 0, input );
+            const Judge::RollingResult r = J.sequenceForwardRolling( input );
+            if( !CompareRolling( J, R, r, input, "seed " + to_string( seed ) + ", interaction " + to_string( k + 1 ) ) ) ok = false;
+            if( J.frozenWeek < J.week ) J.FreezeWeeks( J.frozenWeek + 1, input );
+        }
+    }
+
+    if( !IsSameFile( rollingTraceName, fullTraceName ) )
+    {
+        cerr << "seed " << seed << ": the rolling trace differs from the full trace" << endl;
+        ok = false;
+    }
+    return ok;
+}
+
+// The horizon is cut to its first half and a quarter of the weeks is frozen before the second half is appended again.
+// From then on the rolling simulation has to match a full simulation of the whole instance.
+bool CheckRollingAppend( const Judge& instance, const vector<CalendarInput>& calendars, int seed )
+{
+    const int halfWeek = instance.week / 2, halfOperationN = instance.operationN / 2;
+    Judge J = instance, R = instance;
+    J.week = halfWeek;
+    J.operationN = halfOperationN;
+    J.opList.resize( halfOperationN );
+
+    int k = 0;
+    for( ; k < halfWeek / 2; k++ )
+    {
+        vector<string> input = calendars[k % calendars.size()].strCalendar;
+        for( string& s : input ) s.resize( halfWeek * 2 );
+        if( !J.frozen.has_value() ) J.FreezeWeeks( 0, input );
+        J.FreezeWeeks( J.frozenWeek + 1, input );
+    }
+
+    J.AppendHorizon( instance.week - halfWeek, vector<Judge::Operation>( instance.opList.begin() + halfOperationN, instance.opList.end() ) );
+
+    bool ok = true;
+    for( ; k <= J.week; k++ )
+    {
+        const vector<string>& input = calendars[k % calendars.size()].strCalendar;
+        if( !J.frozen.has_value() ) J.FreezeWeeks( 0, input );
+        const Judge::RollingResult r = J.sequenceForwardRolling( input );
+        if( !CompareRolling( J, R, r, input, "seed " + to_string( seed ) + ", appended horizon, interaction " + to_string( k + 1 ) ) ) ok = false;
+        if( J.frozenWeek < J.week ) J.FreezeWeeks( J.frozenWeek + 1, input );
+    }
+    return ok;
+}
+
+// A solver for the multi check: all 9s, exits after its last calendar without reading the reply
+int RunEarlyExitSolver()
+{
+    int week, resourceN, changeLimitN, reactiveN;
+    cin >> week >> resourceN >> changeLimitN >> reactiveN;
+    for( long long i = 0, costA, costB; i < resourceN * 9LL; i++ ) cin >> costA >> costB;
+
+    for( int k = 0; k < reactiveN; k++ )
+    {
+        for( int i = 0; i < resourceN; i++ ) cout << string( week * 2, '9' ) << '\n';
+        cout << flush;
+        if( k + 1 == reactiveN ) break;
+
+        string line;
+        for( long long i = 0; i <= resourceN * static_cast<long long>( week ); i++ ) cin >> ws && getline( cin, line );
+    }
+    return 0;
+}
+
+// A solver for the multi check that never answers
+int RunHangingSolver()
+{
+    for( ;; ) pause();
+}
+
+string ReadCommandOutput( const string& command )
+{
+    string output;
+    if( FILE* pipe = popen( command.c_str(), "r" ) )
+    {
+        char buf[4096];
+        for( size_t n; ( n = fread( buf, 1, sizeof( buf ), pipe ) ) > 0; ) output.append( buf, n );
+        pclose( pipe );
+    }
+    return output;
+}
+
+// Every solver gets the same score from judge and judge_multi. The early-exit solver on a 200x52 instance checks that
+// a final reply larger than the pipe buffer, which the solver never reads, is dropped without losing the score.
+bool CheckMulti( const string& prefix, int firstSeed, int lastSeed, const string& judge, const string& judgeMulti, vector<string> solvers )
+{
+    vector<string> fileNames;
+    for( int seed = firstSeed; seed <= lastSeed; seed++ ) fileNames.push_back( GenerateInstance( prefix, seed ) );
+    fileNames.push_back( GenerateInstance( prefix, lastSeed + 1, " -resourceN 200 -week 52 -itemN 20" ) );
+
+    string commands, files;
+    for( const string& solver : solvers ) commands += ( commands.empty() ? "" : "," ) + solver;
+    for( const string& fileName : fileNames ) files += " '" + fileName + "'";
+
+    map<pair<string, string>, string> multiScores;
+    stringstream table( ReadCommandOutput( "'" + judgeMulti + "' '" + commands + "' -jobs 2" + files ) );
+    for( string line; getline( table, line ); )
+    {
+        stringstream ss( line );
+        string fileName, solver, score;
+        getline( ss, fileName, '\t' );
+        getline( ss, solver, '\t' );
+        getline( ss, score, '\t' );
+        multiScores[{ fileName, solver }] = score;
+    }
+
+    bool ok = true;
+    for( const string& fileName : fileNames )
+    {
+        for( const string& solver : solvers )
+        {
+            const string log = ReadCommandOutput( "'" + judge + "' '" + solver + "' < '" + fileName + "' 2>&1 >/dev/null" );
+            const size_t at = log.rfind( "\nScore = " );
+            const string score = at == string::npos ? "" : log.substr( at + 9, log.find( '\n', at + 1 ) - at - 9 );
+            if( score.empty() || score != multiScores[{ fileName, solver }] )
+            {
+                cerr << fileName << ' ' << solver << ": judge score " << score << ", judge_multi score " << multiScores[{ fileName, solver }] << endl;
+                ok = false;
+            }
+        }
+    }
+    cerr << "multi: " << fileNames.size() * solvers.size() << " sessions compared" << endl;
+    return ok;
+}
+
+// The hanging solver is killed at the timeout and gets score 0, the other session of the same run is not held up
+bool CheckMultiTimeout( const string& prefix, int seed, const string& judgeMulti, const string& self, const string& solver )
+{
+    const string fileName = GenerateInstance( prefix, seed ), hangingSolver = self + " hang";
+    const auto start = chrono::steady_clock::now();
+    stringstream table( ReadCommandOutput( "'" + judgeMulti + "' '" + hangingSolver + "," + solver + "' -jobs 2 -timeout 1 '" + fileName + "' 2>/dev/null" ) );
+    const double seconds = chrono::duration<double>( chrono::steady_clock::now() - start ).count();
+
+    map<string, string> scores;
+    for( string line; getline( table, line ); )
+    {
+        stringstream ss( line );
+        string file, command, score;
+        getline( ss, file, '\t' );
+        getline( ss, command, '\t' );
+        getline( ss, score, '\t' );
+        scores[command] = score;
+    }
+
+    const bool ok = scores[hangingSolver] == "0" && !scores[solver].empty() && scores[solver] != "0" && seconds < 10;
+    if( !ok ) cerr << fileName << ": timeout run took " << seconds << " s, scores " << scores[hangingSolver] << " and " << scores[solver] << endl;
+    return ok;
+}
+
+int main( int argc, char** argv )
+{
+    if( argc == 2 && string( argv[1] ) == "early-exit" ) return RunEarlyExitSolver();
+    if( argc == 2 && string( argv[1] ) == "hang" ) return RunHangingSolver();
+
+    if( argc <= 2 )
+    {
+        cerr << "usage: " << argv[0] << " <approx|rolling> generator-prefix [-seeds first-last] [-calendars n]\n";
+        cerr << "       " << argv[0] << " multi generator-prefix -judge file -judge-multi file [-solver command]... [-seeds first-last]\n";
+        cerr << "  multi always adds " << argv[0] << " early-exit as a solver, and runs " << argv[0] << " hang with a timeout\n";
+        return 0;
+    }
+
+    const string mode = argv[1], prefix = argv[2];
+    int firstSeed = 1, lastSeed = 10, calendarN = 4;
+    string judge, judgeMulti;
+    vector<string> solvers = { string( argv[0] ) + " early-exit" };
+    for( int i = 3; i < argc; i += 2 )
+    {
+        string option = argv[i];
+        if( i + 1 >= argc )
+        {
+            cerr << "missing value for option: " << option << '\n';
+            return 1;
+        }
+
+        string value = argv[i + 1];
+        if( option == "-seeds" )
+        {
+            const size_t dash = value.find( '-' );
+            firstSeed = stoi( value.substr( 0, dash ) );
+            lastSeed = dash == string::npos ? firstSeed : stoi( value.substr( dash + 1 ) );
+        }
+        else if( option == "-calendars" ) calendarN = stoi( value );
+        else if( option == "-judge" ) judge = value;
+        else if( option == "-judge-multi" ) judgeMulti = value;
+        else if( option == "-solver" ) solvers.push_back( value );
+        else
+        {
+            cerr << "unknown option: " << option << '\n';
+            return 1;
+        }
+    }
+
+    if( mode == "multi" )
+    {
+        if( judge.empty() || judgeMulti.empty() )
+        {
+            cerr << "multi needs -judge and -judge-multi\n";
+            return 1;
+        }
+        const bool ok = CheckMulti( prefix, firstSeed, lastSeed, judge, judgeMulti, solvers );
+        return ok && CheckMultiTimeout( prefix, firstSeed, judgeMulti, argv[0], solvers.back() ) ? 0 : 1;
+    }
+
+    if( mode != "approx" && mode != "rolling" )
+    {
+        cerr << "unknown check: " << mode << '\n';
+        return 1;
+    }
+
+    int failed = 0, inflatedN = 0;
+    for( int seed = firstSeed; seed <= lastSeed; seed++ )
+    {
+        Judge J;
+        if( !LoadInstance( J, prefix, seed ) ) return 1;
+
+        const vector<CalendarInput> calendars = CreateCalendars( J, calendarN, seed );
+        if( mode == "approx" && !CheckApprox( J, calendars, seed, inflatedN ) ) failed++;
+        if( mode == "rolling" && !( CheckRolling( J, calendars, seed, prefix ) && CheckRollingAppend( J, calendars, seed ) ) ) failed++;
+    }
+
+    cerr << mode << ": " << lastSeed - firstSeed + 1 - failed << " of " << lastSeed - firstSeed + 1 << " seeds passed";
+    if( mode == "approx" ) cerr << ", " << inflatedN << " of " << ( lastSeed - firstSeed + 1 ) * calendarN << " simulations with inflated chunks";
+    cerr << endl;
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,505 @@
+// multi-session judge, runs many (input file, solver) sessions from one process
+//
+// Every input file is parsed once and its judge is shared by the sessions of all solvers. The solvers talk over
+// non-blocking pipes that are watched by one epoll loop: a session's calendar is simulated as soon as its last line has
+// arrived, and the reply is written as far as the pipe takes it, the rest follows when the pipe is writable again.
+// The solvers are forked from this process after inputs have been parsed, so solver_max_rss_kb is an upper bound that
+// includes the parsed instances. Use judge for the solver's memory.
+// A finished solver is reaped when its pidfd becomes readable, so a solver that is slow to exit only holds its own job
+// slot. With -timeout, a solver that is still running at its deadline is killed, and if its session has not finished
+// yet, it is scored like an invalid output.
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <queue>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <errno.h>
+#include <sys/epoll.h>
+
+#include "judge.h"
+#include "reactive.h"
+
+
+struct Instance
+{
+    string fileName;
+    unique_ptr<Judge> judge; // parsed when its first session starts, freed after its last one
+    int remainingSessions = 0;
+};
+
+struct Session
+{
+    Instance* instance;
+    string command;
+    ReactiveSession reactive;
+
+    vector<string> input; // lines of the current calendar
+    string reply; // not written yet
+    size_t replyOffset = 0;
+    bool waitingForInput = false; // the solver's stdin is registered for EPOLLOUT
+    bool inputClosed = false; // the solver closed its stdin, later replies are dropped like the judge's failed writes
+    int exitFd = -1; // pidfd of the finished solver until it is reaped
+
+    int interaction = 0; // completed interactions
+    long long result = 0; // best score, -1 after an invalid output like the judge
+    bool running = false;
+    bool finished = false;
+};
+
+string FormatHeader( const Judge& J )
+{
+    stringstream ss;
+    ss << J.week << ' ' << J.resourceN << ' ' << J.resCalendarChangeLimitN << ' ' << J.reactiveN << endl;
+    for( auto& e : J.costTypeA )
+    {
+        ss << e.second << ' ' << J.costTypeB.at( e.first ) << endl;
+    }
+    return ss.str();
+}
+
+// Same checks and messages as the judge, empty if the calendar is valid
+string CheckInput( const Judge& J, const vector<string>& input )
+{
+    for( const string& s : input )
+    {
+        if( s.size() != static_cast<size_t>( J.week ) * 2 )
+            return "The length of calendar pattern must be " + to_string( J.week * 2 );
+
+        for( char c : s )
+        {
+            if( !( '1' <= c && c <= '9' ) )
+                return "The Calendar pattern must be in the range 1~9";
+        }
+    }
+    return "";
+}
+
+string FormatReply( long long score, int chLimVioCnt, int let, const map<pair<int, int>, double>& loadRate,
+                    map<pair<int, int>, int>& letOpCount )
+{
+    stringstream ss;
+    ss << score << ' ' << chLimVioCnt << ' ' << let << endl;
+    for( auto& e : loadRate )
+    {
+        ss << to_string( e.second ) << ' ' << to_string( letOpCount[e.first] ).substr( 0, 5 ) << endl;
+    }
+    return ss.str();
+}
+
+// What an epoll event of a session is about, in the low bits of its data
+enum EventSource
+{
+    SOLVER_OUTPUT,
+    SOLVER_INPUT,
+    SOLVER_EXIT,
+    EVENT_SOURCE_BITS = 2
+};
+
+class EventLoop
+{
+public:
+    EventLoop( vector<Session>& sessions, int jobs, int solverLog, double timeout )
+        : sessions( sessions ), jobs( jobs ), solverLog( solverLog ), timeout( timeout )
+    {
+        epollFd = epoll_create1( EPOLL_CLOEXEC );
+    }
+
+    ~EventLoop()
+    {
+        close( epollFd );
+    }
+
+    bool Run()
+    {
+        if( epollFd < 0 )
+        {
+            cerr << "epoll: failed to create the event loop" << endl;
+            return false;
+        }
+
+        size_t next = 0;
+        vector<epoll_event> events( 64 );
+        while( true )
+        {
+            while( runningN < jobs && next < sessions.size() )
+            {
+                Start( sessions[next++] );
+            }
+            if( runningN == 0 ) return true;
+
+            const int n = epoll_wait( epollFd, events.data(), static_cast<int>( events.size() ), GetWaitTime() );
+            if( n < 0 )
+            {
+                if( errno == EINTR ) continue;
+                cerr << "epoll: failed to wait for the solvers" << endl;
+                return false;
+            }
+
+            for( int i = 0; i < n; i++ )
+            {
+                Session& session = sessions[events[i].data.u64 >> EVENT_SOURCE_BITS];
+                const int source = events[i].data.u64 & ( ( 1 << EVENT_SOURCE_BITS ) - 1 );
+                if( source == SOLVER_EXIT ) Reap( session, WNOHANG );
+                else if( session.finished ) continue;
+                else if( source == SOLVER_INPUT ) Flush( session );
+                else Receive( session );
+            }
+            KillExpiredSessions();
+        }
+    }
+
+private:
+    vector<Session>& sessions;
+    int jobs;
+    int solverLog;
+    int epollFd;
+    int runningN = 0;
+    chrono::duration<double> timeout; // zero for none
+    // deadlines of the sessions, reaped solvers are skipped when they come up
+    priority_queue<pair<chrono::steady_clock::time_point, size_t>, vector<pair<chrono::steady_clock::time_point, size_t>>, greater<>> deadlines;
+
+    uint64_t GetEventData( const Session& session, EventSource source ) const
+    {
+        return static_cast<uint64_t>( &session - sessions.data() ) << EVENT_SOURCE_BITS | source;
+    }
+
+    bool IsReaped( const Session& session ) const
+    {
+        return session.finished && session.exitFd < 0;
+    }
+
+    // Milliseconds until the nearest deadline, -1 for none
+    int GetWaitTime()
+    {
+        while( !deadlines.empty() && IsReaped( sessions[deadlines.top().second] ) ) deadlines.pop();
+        if( deadlines.empty() ) return -1;
+
+        const auto wait = chrono::ceil<chrono::milliseconds>( deadlines.top().first - chrono::steady_clock::now() ).count();
+        return static_cast<int>( clamp<long long>( wait, 0, INT_MAX ) );
+    }
+
+    void KillExpiredSessions()
+    {
+        const auto now = chrono::steady_clock::now();
+        while( !deadlines.empty() && deadlines.top().first <= now )
+        {
+            Session& session = sessions[deadlines.top().second];
+            deadlines.pop();
+            if( IsReaped( session ) ) continue;
+
+            // the pidfd reaps it like any other finished solver
+            session.reactive.kill();
+            if( !session.finished ) Finish( session, "time limit exceeded" );
+        }
+    }
+
+    bool Watch( int op, int fd, uint32_t events, uint64_t data )
+    {
+        epoll_event event = {};
+        event.events = events;
+        event.data.u64 = data;
+        return epoll_ctl( epollFd, op, fd, &event ) == 0;
+    }
+
+    void Start( Session& session )
+    {
+        Instance& instance = *session.instance;
+        if( !instance.judge )
+        {
+            ifstream in( instance.fileName );
+            instance.judge = make_unique<Judge>();
+            instance.judge->Input( in );
+        }
+
+        session.running = true;
+        runningN++;
+
+        cout.flush(); // the forked child exits through the stdio buffers
+        const int stderrCopy = dup( 2 );
+        dup2( solverLog, 2 );
+        session.reactive.own_process_group = true;
+        const int failed = session.reactive.start( session.command );
+        dup2( stderrCopy, 2 );
+        close( stderrCopy );
+
+        if( failed != 0 )
+        {
+            Finish( session, "cannot start the solver" );
+            return;
+        }
+
+        fcntl( session.reactive.input, F_SETFL, fcntl( session.reactive.input, F_GETFL ) | O_NONBLOCK );
+        fcntl( session.reactive.output, F_SETFL, fcntl( session.reactive.output, F_GETFL ) | O_NONBLOCK );
+        if( !Watch( EPOLL_CTL_ADD, session.reactive.output, EPOLLIN, GetEventData( session, SOLVER_OUTPUT ) ) )
+        {
+            Finish( session, "cannot watch the solver's output" );
+            return;
+        }
+
+        if( timeout.count() > 0 )
+        {
+            deadlines.emplace( chrono::steady_clock::now() + chrono::duration_cast<chrono::steady_clock::duration>( timeout ), &session - sessions.data() );
+        }
+
+        Send( session, FormatHeader( *instance.judge ) );
+    }
+
+    void Send( Session& session, const string& message )
+    {
+        session.reply += message;
+        Flush( session );
+    }
+
+    void Flush( Session& session )
+    {
+        while( !session.inputClosed && session.replyOffset < session.reply.size() )
+        {
+            const ssize_t n = write( session.reactive.input, session.reply.data() + session.replyOffset, session.reply.size() - session.replyOffset );
+            if( n < 0 )
+            {
+                if( errno == EINTR ) continue;
+                if( errno != EAGAIN )
+                {
+                    // EPIPE or ECONNRESET, e.g. from a solver that exits after its last calendar without reading the
+                    // reply. The judge ignores failed writes and keeps reading, so the replies are dropped from here on.
+                    session.inputClosed = true;
+                    break;
+                }
+
+                if( !session.waitingForInput )
+                {
+                    Watch( EPOLL_CTL_ADD, session.reactive.input, EPOLLOUT, GetEventData( session, SOLVER_INPUT ) );
+                    session.waitingForInput = true;
+                }
+                return;
+            }
+            session.replyOffset += n;
+        }
+
+        session.reply.clear();
+        session.replyOffset = 0;
+        if( session.waitingForInput )
+        {
+            Watch( EPOLL_CTL_DEL, session.reactive.input, 0, 0 );
+            session.waitingForInput = false;
+        }
+
+        if( session.interaction == session.instance->judge->reactiveN ) Finish( session, "" );
+    }
+
+    void Receive( Session& session )
+    {
+        vector<string> lines;
+        const int n = session.reactive.read_lines( lines );
+        if( n < 0 && errno == EAGAIN ) return;
+
+        for( string& line : lines )
+        {
+            Collect( session, move( line ) );
+            if( session.finished ) return;
+        }
+
+        if( n <= 0 )
+        {
+            // the judge would read empty lines from here on
+            Watch( EPOLL_CTL_DEL, session.reactive.output, 0, 0 );
+            if( !session.reactive.partial.empty() ) Collect( session, move( session.reactive.partial ) );
+            while( !session.finished && session.interaction < session.instance->judge->reactiveN ) Collect( session, "" );
+            // after the last calendar only its reply is left, Flush finishes the session once it is written or dropped
+        }
+    }
+
+    // Adds one line of the solver's output, simulates the calendar when it is complete
+    void Collect( Session& session, string line )
+    {
+        Judge& J = *session.instance->judge;
+        if( session.interaction == J.reactiveN ) return; // output after the last calendar is ignored
+
+        session.input.emplace_back( move( line ) );
+        if( session.input.size() < static_cast<size_t>( J.resourceN ) ) return;
+
+        if( string error = CheckInput( J, session.input ); !error.empty() )
+        {
+            session.result = -1;
+            Finish( session, error );
+            return;
+        }
+
+        auto [score, let, chLimVioCnt, loadRate, letOpCount] = J.reactive( move( session.input ) );
+        session.input.clear();
+        session.result = max( session.result, score );
+        session.interaction++;
+        Send( session, FormatReply( score, chLimVioCnt, let, loadRate, letOpCount ) );
+    }
+
+    void Finish( Session& session, const string& error )
+    {
+        session.finished = true;
+        if( !error.empty() )
+        {
+            cerr << session.instance->fileName << ' ' << session.command << ": !!! Invalid Output !!! Error: " << error << endl;
+            session.result = -1;
+        }
+
+        if( session.reactive.pid > 0 )
+        {
+            if( session.waitingForInput ) Watch( EPOLL_CTL_DEL, session.reactive.input, 0, 0 );
+            Watch( EPOLL_CTL_DEL, session.reactive.output, 0, 0 );
+            if( !error.empty() )
+            {
+                // a solver that is still writing gets SIGPIPE instead of blocking on a full pipe
+                close( session.reactive.output );
+                session.reactive.output = -1;
+            }
+            session.reactive.close_input();
+        }
+
+        // the next session of the same input file may start right away, keep the judge until it has
+        if( --session.instance->remainingSessions == 0 ) session.instance->judge.reset();
+
+        if( session.reactive.pid <= 0 )
+        {
+            runningN--;
+            return;
+        }
+
+        // the solver keeps its job slot until it has exited, without a pidfd it is waited for here like in the judge
+        session.exitFd = static_cast<int>( syscall( SYS_pidfd_open, session.reactive.pid, 0 ) );
+        if( session.exitFd < 0 || !Watch( EPOLL_CTL_ADD, session.exitFd, EPOLLIN, GetEventData( session, SOLVER_EXIT ) ) )
+        {
+            Reap( session, 0 );
+        }
+    }
+
+    void Reap( Session& session, int options )
+    {
+        if( !session.reactive.reap( options ) ) return;
+
+        if( session.exitFd >= 0 )
+        {
+            Watch( EPOLL_CTL_DEL, session.exitFd, 0, 0 );
+            close( session.exitFd );
+            session.exitFd = -1;
+        }
+        runningN--;
+    }
+};
+
+int main( int argc, char** argv )
+{
+    if( argc <= 1 )
+    {
+        cerr << "usage: " << argv[0] << " <command>[,<command>...] [-jobs n] [-solver-log file] [-timeout seconds] input-file...\n";
+        cerr << "  runs every command on every input file, at most n sessions at a time (default: the number of CPUs)\n";
+        cerr << "  a session still running after the timeout is killed and gets score 0 (default: no timeout)\n";
+        cerr << "  prints file, solver, score, interactions, solver CPU time in ms and max RSS in KiB per session\n";
+        return 0;
+    }
+
+    vector<string> commands;
+    {
+        stringstream ss( argv[1] );
+        for( string command; getline( ss, command, ',' ); )
+        {
+            if( !command.empty() ) commands.push_back( command );
+        }
+    }
+
+    int jobs = max( 1u, thread::hardware_concurrency() );
+    double timeout = 0;
+    string solverLogFileName = "/dev/null";
+    vector<string> inputFileNames;
+    for( int i = 2; i < argc; i++ )
+    {
+        string option = argv[i];
+        if( option[0] != '-' )
+        {
+            inputFileNames.push_back( option );
+            continue;
+        }
+
+        if( i + 1 >= argc )
+        {
+            cerr << "missing value for option: " << option << '\n';
+            return 1;
+        }
+
+        string value = argv[++i];
+        if( option == "-jobs" ) jobs = max( 1, stoi( value ) );
+        else if( option == "-solver-log" ) solverLogFileName = value;
+        else if( option == "-timeout" ) timeout = max( 0.0, stod( value ) );
+        else
+        {
+            cerr << "unknown option: " << option << '\n';
+            return 1;
+        }
+    }
+
+    for( const auto& inputFileName : inputFileNames )
+    {
+        if( !ifstream( inputFileName ) )
+        {
+            cerr << "cannot open input file " << inputFileName << endl;
+            return 1;
+        }
+    }
+
+    // the solvers of all sessions share stderr, by default their logs are dropped
+    const int solverLog = open( solverLogFileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644 );
+    if( solverLog < 0 )
+    {
+        cerr << "cannot open solver log file: " << solverLogFileName << endl;
+        return 1;
+    }
+
+    // sessions of the same input file are next to each other, so only about jobs judges are in memory at a time
+    vector<Instance> instances( inputFileNames.size() );
+    vector<Session> sessions;
+    sessions.reserve( inputFileNames.size() * commands.size() );
+    for( size_t i = 0; i < inputFileNames.size(); i++ )
+    {
+        instances[i].fileName = inputFileNames[i];
+        instances[i].remainingSessions = static_cast<int>( commands.size() );
+        for( const string& command : commands )
+        {
+            Session session;
+            session.instance = &instances[i];
+            session.command = command;
+            sessions.push_back( move( session ) );
+        }
+    }
+
+    EventLoop loop( sessions, jobs, solverLog, timeout );
+    const bool completed = loop.Run();
+    close( solverLog );
+    if( !completed ) return 1;
+
+    auto milliseconds = [] ( const timeval& time ) { return time.tv_sec * 1000.0 + time.tv_usec / 1000.0; };
+
+    map<string, long long> totalScores;
+    cout << "file\tsolver\tscore\tinteractions\tsolver_cpu_ms\tsolver_max_rss_kb\n";
+    for( const Session& session : sessions )
+    {
+        const long long score = max( session.result, 0LL );
+        const struct rusage& usage = session.reactive.usage;
+        cout << session.instance->fileName << '\t' << session.command << '\t' << score << '\t' << session.interaction << '\t'
+             << fixed << setprecision( 1 ) << milliseconds( usage.ru_utime ) + milliseconds( usage.ru_stime ) << '\t'
+             << usage.ru_maxrss << '\n';
+        totalScores[session.command] += score;
+    }
+
+    for( const string& command : commands )
+    {
+        cerr << command << ": total score " << totalScores[command] << " on " << inputFileNames.size() << " files" << endl;
+    }
+    return 0;
+}
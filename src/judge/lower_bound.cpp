@@ -0,0 +1,129 @@
+// lower bound of the weekly cost and upper bound of the score of an instance
+
+#include <fstream>
+#include <iostream>
+#include "Problem.h"
+
+
+// A calendar can only have no late operations if on every resource, the work of the operations whose let is at most
+// t fits into the working time before t, for every t. Relaxing the change limit, the resources are independent and the
+// cheapest calendar of a resource that satisfies these cumulative capacity requirements is found exactly by a dynamic
+// program over the weeks and the working hours accumulated before each week.
+//
+// Returns -1 if the requirements cannot be met even with the largest patterns
+long long GetResourceCostLowerBound( const ProblemVar& P, int res )
+{
+    const int typeN = static_cast<int>( Calendar.totalTime.size() );
+
+    // cumulative demand of the resource in seconds, by let
+    vector<pair<int, long long>> demand; // ( let, prodTime )
+    for( const auto& op : P.opList )
+    {
+        const auto& item = P.itemList[op.itemNo];
+        for( int i = 0; i < item.itemProcN; i++ )
+            if( item.proc[i] == res ) demand.push_back( { op.let, op.prodTime[i] } );
+    }
+    sort( demand.begin(), demand.end() );
+
+    // working seconds of pattern ( a, b ) from the start of its week until offset
+    vector<vector<vector<pair<int, int>>>> weekCalendar( typeN, vector<vector<pair<int, int>>>( typeN ) );
+    for( int a = 0; a < typeN; a++ )
+        for( int b = 0; b < typeN; b++ )
+            Calendar.addCalendar( weekCalendar[a][b], 0, a, b );
+    auto GetWorkingTime = [&weekCalendar] ( int a, int b, long long offset )
+    {
+        long long t = 0;
+        for( auto [startTime, endTime] : weekCalendar[a][b] )
+            t += max( 0LL, min<long long>( endTime, offset ) - startTime );
+        return t;
+    };
+    auto GetWeekHours = [] ( int a, int b ) { return 5 * Calendar.totalTime[a] + 2 * Calendar.totalTime[b]; };
+
+    // need[w][a][b]: working seconds required before week w if it uses pattern ( a, b ), needEnd: after the last week
+    vector<vector<vector<long long>>> need( P.week, vector<vector<long long>>( typeN, vector<long long>( typeN, 0 ) ) );
+    long long needEnd = 0;
+    long long cumulativeDemand = 0;
+    for( size_t i = 0; i < demand.size(); i++ )
+    {
+        cumulativeDemand += demand[i].second;
+        if( i + 1 < demand.size() && demand[i + 1].first == demand[i].first ) continue;
+
+        const long long let = demand[i].first;
+        const long long w = let / WEEK;
+        if( w >= P.week )
+        {
+            needEnd = max( needEnd, cumulativeDemand );
+            continue;
+        }
+
+        for( int a = 0; a < typeN; a++ )
+            for( int b = 0; b < typeN; b++ )
+                need[w][a][b] = max( need[w][a][b], cumulativeDemand - GetWorkingTime( a, b, let - w * WEEK ) );
+    }
+    needEnd = max( needEnd, cumulativeDemand );
+
+    // dp[h]: cheapest cost of the weeks so far with h working hours in total
+    const int maxHours = GetWeekHours( typeN - 1, typeN - 1 ) * P.week;
+    constexpr long long INF = numeric_limits<long long>::max();
+    vector<long long> dp( maxHours + 1, INF ), next( maxHours + 1 );
+    dp[0] = 0;
+    for( int w = 0; w < P.week; w++ )
+    {
+        fill( next.begin(), next.end(), INF );
+        for( int h = 0; h <= maxHours; h++ )
+        {
+            if( dp[h] == INF ) continue;
+            for( int a = 0; a < typeN; a++ )
+                for( int b = 0; b < typeN; b++ )
+                {
+                    if( static_cast<long long>( h ) * HOUR < need[w][a][b] ) continue;
+                    const int nh = h + GetWeekHours( a, b );
+                    const long long cost = dp[h] + P.costTypeA.at( { res, a } ) + P.costTypeB.at( { res, b } );
+                    next[nh] = min( next[nh], cost );
+                }
+        }
+        swap( dp, next );
+    }
+
+    long long best = INF;
+    for( int h = 0; h <= maxHours; h++ )
+        if( static_cast<long long>( h ) * HOUR >= needEnd ) best = min( best, dp[h] );
+    return best == INF ? -1 : best;
+}
+
+// Prints one tab separated line per input file
+int main( int argc, char* argv[] )
+{
+    if( argc <= 1 )
+    {
+        cerr << "usage: " << argv[0] << " input-file...\n";
+        return 0;
+    }
+
+    cout << "file\tweeklyCostLowerBound\tmaxScore\n";
+
+    for( int arg = 1; arg < argc; arg++ )
+    {
+        ifstream in( argv[arg] );
+        if( !in )
+        {
+            cerr << "cannot open input file " << argv[arg] << endl;
+            return 1;
+        }
+
+        ProblemVar P;
+        P.Input( in );
+
+        long long cost = 0;
+        for( int i = 0; i < P.resourceN && cost >= 0; i++ )
+        {
+            const long long resourceCost = GetResourceCostLowerBound( P, i );
+            cost = resourceCost < 0 ? -1 : cost + resourceCost;
+        }
+
+        // the judge's score is decreasing in cost / week, so the cheapest cost gives the highest score
+        const long long weeklyCost = cost < 0 ? -1 : cost / P.week;
+        const long long maxScore = weeklyCost <= 0 ? 0 : round( ( 10.0 - log10( static_cast<double>( weeklyCost ) ) ) * 1e9 );
+        cout << argv[arg] << '\t' << weeklyCost << '\t' << maxScore << '\n';
+    }
+}
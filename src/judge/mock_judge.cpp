@@ -0,0 +1,178 @@
+// mock judge, replays the replies of a recorded judge run (judge -transcript) to a solver without simulating
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "demand_model.h"
+#include "reactive.h"
+
+
+struct Interaction
+{
+    vector<string> submission; // resourceN calendar lines
+    vector<string> reply; // score line and resourceN * week load lines
+};
+
+bool ReadTranscript( const string& fileName, DemandModel& model, vector<string>& header, vector<Interaction>& interactions )
+{
+    ifstream in( fileName );
+    if( !in ) return false;
+
+    vector<string> lines;
+    for( string line; getline( in, line ); ) lines.emplace_back( line );
+    if( lines.empty() ) return false;
+
+    const int typeN = static_cast<int>( Calendar.totalTime.size() );
+    int week, resourceN;
+    std::stringstream( lines[0] ) >> week >> resourceN;
+    if( lines.size() < static_cast<size_t>( 1 + resourceN * typeN ) ) return false;
+
+    header.assign( lines.begin(), lines.begin() + 1 + resourceN * typeN );
+    model.ReadHeader( header );
+
+    // the judge stops replying after an invalid submission, so the last interaction may be incomplete
+    size_t index = header.size();
+    while( index + resourceN + 1 + resourceN * week <= lines.size() )
+    {
+        Interaction interaction;
+        interaction.submission.assign( lines.begin() + index, lines.begin() + index + resourceN );
+        index += resourceN;
+        interaction.reply.assign( lines.begin() + index, lines.begin() + index + 1 + resourceN * week );
+        index += 1 + resourceN * week;
+        interactions.emplace_back( interaction );
+    }
+
+    // the whole recording is known upfront, later interactions overwrite the estimates of earlier ones
+    for( const Interaction& interaction : interactions )
+        model.Observe( interaction.submission, model.ParseReply( interaction.reply ) );
+
+    return true;
+}
+
+int main( int argc, char** argv )
+{
+    if( argc <= 1 )
+    {
+        cerr << "usage: " << argv[0] << " <command> -transcript transcript-file [-policy replay|model] [-transport pipe|shm]\n";
+        cerr << "  replay: always send the recorded replies\n";
+        cerr << "  model:  send the recorded reply while the solver repeats the recorded calendars, estimate it afterwards\n";
+        return 0;
+    }
+
+    string transcriptFileName, policy = "replay";
+    bool sharedMemory = false;
+    for( int i = 2; i < argc; i += 2 )
+    {
+        string option = argv[i];
+        if( i + 1 >= argc )
+        {
+            cerr << "missing value for option: " << option << '\n';
+            return 1;
+        }
+
+        if( option == "-transcript" )
+        {
+            transcriptFileName = argv[i + 1];
+        }
+        else if( option == "-policy" )
+        {
+            policy = argv[i + 1];
+            if( policy != "replay" && policy != "model" )
+            {
+                cerr << "unknown policy: " << policy << '\n';
+                return 1;
+            }
+        }
+        else if( option == "-transport" )
+        {
+            string transport = argv[i + 1];
+            if( transport != "pipe" && transport != "shm" )
+            {
+                cerr << "unknown transport: " << transport << '\n';
+                return 1;
+            }
+            sharedMemory = transport == "shm";
+        }
+        else
+        {
+            cerr << "unknown option: " << option << '\n';
+            return 1;
+        }
+    }
+
+    DemandModel model;
+    vector<string> header;
+    vector<Interaction> interactions;
+    if( transcriptFileName.empty() || !ReadTranscript( transcriptFileName, model, header, interactions ) )
+    {
+        cerr << "cannot read transcript file: " << transcriptFileName << endl;
+        return 1;
+    }
+    if( interactions.empty() )
+    {
+        cerr << "transcript has no interactions" << endl;
+        return 1;
+    }
+
+    if( reactive_start( argv[1], sharedMemory ) != 0 ) return 1;
+
+    {
+        stringstream ss;
+        for( const string& line : header ) ss << line << '\n';
+        reactive_write( ss.str() );
+    }
+
+    long long bestScore = 0;
+    int divergedAt = -1;
+    int modelReplies = 0;
+    for( int k = 0; k < model.reactiveN; k++ )
+    {
+        vector<string> input;
+        for( int j = 0; j < model.resourceN; j++ )
+        {
+            string s = reactive_read();
+            if( !s.empty() && s.back() == '\n' )
+            {
+                s.pop_back();
+            }
+            input.emplace_back( s );
+        }
+
+        for( const string& s : input )
+        {
+            if( s.size() != static_cast<size_t>( model.week ) * 2 || s.find_first_not_of( "123456789" ) != string::npos )
+            {
+                cerr << "Error: invalid calendar in interaction " << k + 1 << endl;
+                reactive_end();
+                return 1;
+            }
+        }
+
+        const Interaction& recorded = interactions[min<size_t>( k, interactions.size() - 1 )];
+        if( divergedAt < 0 && ( k >= static_cast<int>( interactions.size() ) || input != recorded.submission ) ) divergedAt = k;
+
+        DemandModel::Reply reply;
+        if( policy == "replay" || divergedAt < 0 )
+        {
+            reply = model.ParseReply( recorded.reply );
+        }
+        else
+        {
+            reply = model.Evaluate( input );
+            modelReplies++;
+        }
+
+        bestScore = max( bestScore, reply.score );
+        reactive_write( reply.Format() );
+    }
+
+    reactive_end();
+
+    cerr << "Diverged = " << ( divergedAt < 0 ? 0 : divergedAt + 1 ) << endl;
+    cerr << "Model replies = " << modelReplies << endl;
+    cerr << "Score = " << bestScore << endl;
+    return 0;
+}
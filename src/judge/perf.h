@@ -0,0 +1,282 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+
+// Hardware performance counters around the phases of the judge, collected with perf_event_open
+// Counters that can not be opened (e.g. no PMU in a virtual machine) are reported as "-".
+// The hardware counters are one group led by CYCLES, so they always count over the same time and their ratios hold.
+// When the PMU is shared (multiplexing, e.g. in a VM or with the NMI watchdog), the group does not run for the whole
+// phase: its counts are scaled by time enabled / time running and the phase is marked as multiplexed.
+class PerfProfiler
+{
+public:
+    enum Phase
+    {
+        PARSE,
+        CALENDAR,
+        SIMULATE,
+        COST,
+        REPLY,
+        PHASE_N
+    };
+
+    enum Counter
+    {
+        CYCLES,
+        INSTRUCTIONS,
+        CACHE_MISSES,
+        BRANCH_MISSES,
+        TASK_CLOCK,
+        COUNTER_N
+    };
+
+    static constexpr const char* PHASE_NAMES[PHASE_N] = { "parse", "calendar", "simulate", "cost", "reply" };
+    static constexpr const char* COUNTER_NAMES[COUNTER_N] = { "cycles", "instructions", "cache-misses", "branch-misses", "task-clock-ns" };
+
+private:
+    struct Reading
+    {
+        uint64_t value[COUNTER_N];
+        uint64_t enabled[COUNTER_N]; // ns the counter was enabled
+        uint64_t running[COUNTER_N]; // ns it was actually on the PMU
+    };
+
+    int fd[COUNTER_N];
+    int groupIndex[COUNTER_N]; // position in the group of CYCLES, -1 for counters read on their own
+    Reading begin;
+    uint64_t interaction[PHASE_N][COUNTER_N];
+    uint64_t total[PHASE_N][COUNTER_N];
+    bool interactionMultiplexed[PHASE_N];
+    bool totalMultiplexed[PHASE_N];
+    int interactionN = 0;
+    std::ostream* out = nullptr;
+
+    void ReadCounters( Reading& reading )
+    {
+        memset( &reading, 0, sizeof( reading ) );
+#ifdef __linux__
+        if( fd[CYCLES] >= 0 )
+        {
+            // number of counters, time enabled, time running, then the counters in the order they joined the group
+            uint64_t group[3 + COUNTER_N];
+            const ssize_t n = read( fd[CYCLES], group, sizeof( group ) );
+            for( int i = 0; n >= static_cast<ssize_t>( 3 * sizeof( uint64_t ) ) && i < COUNTER_N; i++ )
+            {
+                if( groupIndex[i] < 0 || static_cast<uint64_t>( groupIndex[i] ) >= group[0] ) continue;
+                reading.value[i] = group[3 + groupIndex[i]];
+                reading.enabled[i] = group[1];
+                reading.running[i] = group[2];
+            }
+        }
+
+        for( int i = 0; i < COUNTER_N; i++ )
+        {
+            uint64_t single[3]; // value, time enabled, time running
+            if( fd[i] < 0 || groupIndex[i] >= 0 || read( fd[i], single, sizeof( single ) ) != sizeof( single ) ) continue;
+            reading.value[i] = single[0];
+            reading.enabled[i] = single[1];
+            reading.running[i] = single[2];
+        }
+#endif
+    }
+
+    static int OpenCounter( uint32_t type, uint64_t config, int groupFd, uint64_t readFormat )
+    {
+#ifdef __linux__
+        perf_event_attr attr;
+        memset( &attr, 0, sizeof( attr ) );
+        attr.size = sizeof( attr );
+        attr.type = type;
+        attr.config = config;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = readFormat | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        return static_cast<int>( syscall( SYS_perf_event_open, &attr, 0, -1, groupFd, PERF_FLAG_FD_CLOEXEC ) );
+#else
+        return -1;
+#endif
+    }
+
+    // Opens a hardware counter in the group of CYCLES, or on its own when there is no group
+    void OpenGroupCounter( Counter counter, uint64_t config, int& groupN )
+    {
+#ifdef __linux__
+        const bool leader = counter == CYCLES;
+        fd[counter] = OpenCounter( PERF_TYPE_HARDWARE, config, leader ? -1 : fd[CYCLES], leader ? PERF_FORMAT_GROUP : 0 );
+        if( fd[counter] < 0 && !leader && fd[CYCLES] >= 0 )
+        {
+            // does not fit into the group, e.g. too few PMU counters
+            fd[counter] = OpenCounter( PERF_TYPE_HARDWARE, config, -1, 0 );
+            return;
+        }
+        if( fd[counter] >= 0 && fd[CYCLES] >= 0 ) groupIndex[counter] = groupN++;
+#endif
+    }
+
+    void PrintValue( std::ostream& os, int counter, uint64_t value ) const
+    {
+        if( fd[counter] < 0 ) os << '-';
+        else os << value;
+    }
+
+    // The counts of a counter that was not on the PMU for the whole phase, scaled up to the whole phase
+    static uint64_t Scale( uint64_t value, uint64_t enabled, uint64_t running )
+    {
+        if( running >= enabled ) return value;
+        if( running == 0 ) return 0;
+        return static_cast<uint64_t>( static_cast<double>( value ) * enabled / running + 0.5 );
+    }
+
+public:
+    // per interaction lines are written to `interactionOut` when it is not null
+    explicit PerfProfiler( std::ostream* interactionOut = nullptr ) : out( interactionOut )
+    {
+        for( int i = 0; i < COUNTER_N; i++ )
+        {
+            fd[i] = -1;
+            groupIndex[i] = -1;
+        }
+#ifdef __linux__
+        int groupN = 0;
+        OpenGroupCounter( CYCLES, PERF_COUNT_HW_CPU_CYCLES, groupN );
+        OpenGroupCounter( INSTRUCTIONS, PERF_COUNT_HW_INSTRUCTIONS, groupN );
+        OpenGroupCounter( CACHE_MISSES, PERF_COUNT_HW_CACHE_MISSES, groupN );
+        OpenGroupCounter( BRANCH_MISSES, PERF_COUNT_HW_BRANCH_MISSES, groupN );
+        // on its own, the task clock is software and measures the whole phase even when the group is not running
+        fd[TASK_CLOCK] = OpenCounter( PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK, -1, 0 );
+#endif
+        memset( interaction, 0, sizeof( interaction ) );
+        memset( total, 0, sizeof( total ) );
+        memset( interactionMultiplexed, 0, sizeof( interactionMultiplexed ) );
+        memset( totalMultiplexed, 0, sizeof( totalMultiplexed ) );
+
+        if( out != nullptr )
+        {
+            *out << "interaction phase";
+            for( const char* name : COUNTER_NAMES ) *out << ' ' << name;
+            *out << " multiplexed\n" << std::flush; // nothing may be left buffered when the solver process is forked
+        }
+    }
+
+    PerfProfiler( const PerfProfiler& ) = delete;
+    PerfProfiler& operator=( const PerfProfiler& ) = delete;
+
+    ~PerfProfiler()
+    {
+#ifdef __linux__
+        // the group members before their leader
+        for( int i = COUNTER_N - 1; i >= 0; i-- )
+            if( fd[i] >= 0 ) close( fd[i] );
+#endif
+    }
+
+    bool Available() const
+    {
+        for( int i = 0; i < COUNTER_N; i++ )
+            if( fd[i] >= 0 ) return true;
+        return false;
+    }
+
+    void Begin()
+    {
+        ReadCounters( begin );
+    }
+
+    void End( Phase phase )
+    {
+        Reading end;
+        ReadCounters( end );
+        for( int i = 0; i < COUNTER_N; i++ )
+        {
+            const uint64_t enabled = end.enabled[i] - begin.enabled[i], running = end.running[i] - begin.running[i];
+            const uint64_t value = Scale( end.value[i] - begin.value[i], enabled, running );
+            interaction[phase][i] += value;
+            total[phase][i] += value;
+            if( running < enabled )
+            {
+                interactionMultiplexed[phase] = true;
+                totalMultiplexed[phase] = true;
+            }
+        }
+    }
+
+    void EndInteraction()
+    {
+        if( out != nullptr )
+        {
+            for( int phase = 0; phase < PHASE_N; phase++ )
+            {
+                *out << interactionN << ' ' << PHASE_NAMES[phase];
+                for( int i = 0; i < COUNTER_N; i++ )
+                {
+                    *out << ' ';
+                    PrintValue( *out, i, interaction[phase][i] );
+                }
+                *out << ' ' << interactionMultiplexed[phase] << '\n';
+            }
+        }
+
+        memset( interaction, 0, sizeof( interaction ) );
+        memset( interactionMultiplexed, 0, sizeof( interactionMultiplexed ) );
+        interactionN++;
+    }
+
+    void Report( std::ostream& os ) const
+    {
+        os << "Perf counters (" << interactionN << " interactions)\n";
+        os << std::setw( 10 ) << "phase";
+        for( const char* name : COUNTER_NAMES ) os << std::setw( 16 ) << name;
+        os << std::setw( 8 ) << "IPC" << '\n';
+
+        bool multiplexed = false;
+        for( int phase = 0; phase < PHASE_N; phase++ )
+        {
+            multiplexed |= totalMultiplexed[phase];
+            os << std::setw( 10 ) << ( std::string( totalMultiplexed[phase] ? "*" : "" ) + PHASE_NAMES[phase] );
+            for( int i = 0; i < COUNTER_N; i++ )
+            {
+                os << std::setw( 16 );
+                if( fd[i] < 0 ) os << '-';
+                else os << total[phase][i];
+            }
+
+            os << std::setw( 8 );
+            if( fd[CYCLES] < 0 || fd[INSTRUCTIONS] < 0 || total[phase][CYCLES] == 0 ) os << '-';
+            else os << std::fixed << std::setprecision( 2 ) << static_cast<double>( total[phase][INSTRUCTIONS] ) / total[phase][CYCLES];
+            os << '\n';
+        }
+        if( multiplexed ) os << "* multiplexed: the counters did not run for the whole phase, the counts are scaled estimates\n";
+    }
+};
+
+// Measures the enclosing scope as `phase`, does nothing when the profiler is null
+class PerfScope
+{
+private:
+    PerfProfiler* profiler;
+    PerfProfiler::Phase phase;
+
+public:
+    PerfScope( PerfProfiler* profiler, PerfProfiler::Phase phase ) : profiler( profiler ), phase( phase )
+    {
+        if( profiler != nullptr ) profiler->Begin();
+    }
+
+    ~PerfScope()
+    {
+        if( profiler != nullptr ) profiler->End( phase );
+    }
+};
@@ -1,68 +1,216 @@
 #pragma once
 
 #include <algorithm>
+#include <sstream>
 #include <string>
+#include <vector>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <fcntl.h>
+#include <sys/prctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
 #include <sys/wait.h>
 #include <signal.h>
 #include <unistd.h>
 
-pid_t __reactive_pid;
-int __reactive_input, __reactive_output;
+#include "shm_ring.h"
 
-int reactive_start(std::string command) {
-    int pipe_c2p[2], pipe_p2c[2]; int size;
+// One judge-solver connection. The reactive_* functions below drive a single default session, judge_multi drives
+// many sessions from one epoll loop.
+struct ReactiveSession {
+    pid_t pid = -1;
+    int input = -1, output = -1;
+    shm_ring::Channel *channel = nullptr;
+    struct rusage usage = {}; // resource usage of the solver, filled by end or reap
+    char buf[1024]; int len = 0; // read from the solver but not returned yet
+    std::string partial; // start of an unfinished line, see read_lines
+    bool own_process_group = false; // set before start(), so kill() reaches the solver in its shell
 
-    signal(SIGPIPE, SIG_IGN);
-    if (pipe(pipe_c2p) < 0 || pipe(pipe_p2c) < 0) {
-        fprintf(stderr, "pipe: failed to open pipes\n");
-        return 1;
+    bool alive() const {
+        siginfo_t info = {};
+        return waitid(P_PID, pid, &info, WEXITED | WNOHANG | WNOWAIT) == 0 && info.si_pid == 0;
     }
-    if ((__reactive_pid = fork()) < 0) {
-        fprintf(stderr, "fork: failed to fork\n");
-        return 1;
+
+    // The command is run by /bin/sh like system() does, so quoting, redirections, variable assignments and compound
+    // commands work. The child is the shell itself rather than a second fork of system(), and the usage that end()
+    // collects includes the solver the shell has waited for: the CPU time and context switches are the solver's plus
+    // the shell's few, the max RSS is the larger of the two. It is at least the memory of the judge image the child was
+    // forked from, start the solver before the judge grows to keep that out of the measurement.
+    [[noreturn]] static void exec_command(const std::string &command) {
+        execl("/bin/sh", "sh", "-c", command.c_str(), (char *)nullptr);
+        fprintf(stderr, "exec: failed to run /bin/sh\n");
+        _exit(127);
     }
-    if (__reactive_pid == 0) {
-        close(pipe_p2c[1]); close(pipe_c2p[0]);
-        dup2(pipe_p2c[0], 0); dup2(pipe_c2p[1], 1);
+
+    // Talks to the solver through shared memory, the solver needs shm_shim.h
+    int start_shm(std::string command) {
+        int fd;
+        if ((channel = shm_ring::create(fd)) == nullptr) {
+            fprintf(stderr, "memfd: failed to create shared memory\n");
+            return 1;
+        }
+
+        pid_t parent = getpid();
+        if ((pid = fork()) < 0) {
+            fprintf(stderr, "fork: failed to fork\n");
+            return 1;
+        }
+        if (pid == 0) {
+            prctl(PR_SET_PDEATHSIG, SIGKILL);
+            if (getppid() != parent) _exit(1);
+
+            int null = open("/dev/null", O_RDWR);
+            dup2(null, 0); dup2(null, 1); close(null);
+            setenv(shm_ring::FD_ENVIRONMENT_VARIABLE, std::to_string(fd).c_str(), 1);
+            exec_command(command);
+        }
+        close(fd);
+        return 0;
+    }
+
+    int start(std::string command, bool shared_memory = false) {
+        if (shared_memory) return start_shm(command);
+
+        int pipe_c2p[2], pipe_p2c[2];
+
+        signal(SIGPIPE, SIG_IGN);
+        if (pipe(pipe_c2p) < 0 || pipe(pipe_p2c) < 0) {
+            fprintf(stderr, "pipe: failed to open pipes\n");
+            return 1;
+        }
+        // the judge's ends must not leak into the solvers of later sessions, or they keep each other's stdin open
+        fcntl(pipe_p2c[1], F_SETFD, FD_CLOEXEC); fcntl(pipe_c2p[0], F_SETFD, FD_CLOEXEC);
+        if ((pid = fork()) < 0) {
+            fprintf(stderr, "fork: failed to fork\n");
+            return 1;
+        }
+        if (pid == 0) {
+            close(pipe_p2c[1]); close(pipe_c2p[0]);
+            dup2(pipe_p2c[0], 0); dup2(pipe_c2p[1], 1);
+            close(pipe_p2c[0]); close(pipe_c2p[1]);
+            syscall(SYS_close_range, 3, ~0U, 0); // only stdin, stdout and stderr are passed on to the solver
+            if (own_process_group) setpgid(0, 0);
+            exec_command(command);
+        }
+        if (own_process_group) setpgid(pid, pid); // either side may run first
         close(pipe_p2c[0]); close(pipe_c2p[1]);
-        exit(system(command.c_str()) ? 1 : 0);
+        input = pipe_p2c[1];
+        output = pipe_c2p[0];
+        return 0;
+    }
+
+    void end() {
+        int status;
+        if (channel) {
+            shm_ring::close(channel->toSolver);
+            shm_ring::close(channel->toJudge);
+        } else {
+            close(input);
+        }
+        // the child is the solver itself, see split_command for what ru_maxrss covers
+        wait4(pid, &status, WUNTRACED, &usage);
+        if (channel) {
+            shm_ring::detach(channel);
+            channel = nullptr;
+        } else {
+            close(output);
+        }
+        input = output = -1;
+    }
+
+    // end() in two steps for an event loop that must not block on one solver, pipe transport only: close_input() lets
+    // the solver see the end of its input, reap() collects its usage and closes its output once it has exited. With
+    // WNOHANG, reap() returns false while the solver is still running.
+    void close_input() {
+        close(input);
+        input = -1;
+    }
+
+    // Kills the solver and, with own_process_group, the shell it runs in. reap() still has to collect it.
+    void kill() {
+        ::kill(own_process_group ? -pid : pid, SIGKILL);
     }
-    close(pipe_p2c[0]); close(pipe_c2p[1]);
-    __reactive_input = pipe_p2c[1];
-    __reactive_output = pipe_c2p[0];
-    return 0;
+
+    bool reap(int options) {
+        int status;
+        if (wait4(pid, &status, options, &usage) == 0) return false;
+        if (output >= 0) close(output);
+        output = -1;
+        return true;
+    }
+
+    void write(std::string buf) {
+        if (channel) shm_ring::write(channel->toSolver, buf.c_str(), buf.size(), [this] { return alive(); });
+        else ::write(input, buf.c_str(), buf.size());
+    }
+
+    int fill(char *buf, int max_len) {
+        if (channel) return shm_ring::read(channel->toJudge, buf, max_len, [this] { return alive(); });
+        return ::read(output, buf, max_len);
+    }
+
+    std::string read(int max_len = 100000) {
+        std::string result;
+        while (result.size() < max_len) {
+            if (!len) {
+                len = fill(buf, std::min(1000, (int)(max_len - result.size())));
+                if (!len) return result;
+            }
+            char *pos = (char *)memchr(buf, '\n', len);
+            if (pos) {
+                result += std::string(buf, pos - buf + 1);
+                memmove(buf, pos + 1, len - (pos + 1 - buf));
+                len -= pos - buf + 1;
+                return result;
+            } else {
+                result += std::string(buf, len);
+                len = 0;
+            }
+        }
+        return result;
+    }
+
+    // For event loops on a non-blocking pipe: reads what is available and appends the complete lines, without their
+    // '\n', to lines. Returns the number of bytes read, 0 at the end of the solver's output and -1 if nothing was
+    // available (errno EAGAIN) or on errors.
+    int read_lines(std::vector<std::string> &lines) {
+        int n = ::read(output, buf, sizeof(buf));
+        if (n <= 0) return n;
+        for (char *begin = buf, *end = buf + n; begin < end;) {
+            char *pos = (char *)memchr(begin, '\n', end - begin);
+            if (!pos) {
+                partial.append(begin, end);
+                break;
+            }
+            partial.append(begin, pos);
+            lines.push_back(std::move(partial));
+            partial.clear();
+            begin = pos + 1;
+        }
+        return n;
+    }
+};
+
+ReactiveSession __reactive_session;
+pid_t &__reactive_pid = __reactive_session.pid;
+int &__reactive_input = __reactive_session.input, &__reactive_output = __reactive_session.output;
+shm_ring::Channel *&__reactive_channel = __reactive_session.channel;
+struct rusage &__reactive_usage = __reactive_session.usage;
+
+int reactive_start(std::string command, bool shared_memory = false) {
+    return __reactive_session.start(command, shared_memory);
 }
 
 void reactive_end() {
-    int status;
-    close(__reactive_input);
-    waitpid(__reactive_pid, &status, WUNTRACED);
+    __reactive_session.end();
 }
 
 void reactive_write(std::string buf) {
-    write(__reactive_input, buf.c_str(), buf.size());
+    __reactive_session.write(buf);
 }
 
 std::string reactive_read(int max_len = 100000) {
-    static char buf[1024]; static int len = 0; std::string result;
-    while (result.size() < max_len) {
-        if (!len) {
-            len = read(__reactive_output, buf,
-                       std::min(1000, (int)(max_len - result.size())));
-            if (!len) return result;
-        }
-        char *pos = (char *)memchr(buf, '\n', len);
-        if (pos) {
-            result += std::string(buf, pos - buf + 1);
-            memmove(buf, pos + 1, len - (pos + 1 - buf));
-            len -= pos - buf + 1;
-            return result;
-        } else {
-            result += std::string(buf, len);
-            len = 0;
-        }
-    }
-    return result;
+    return __reactive_session.read(max_len);
 }
@@ -0,0 +1,253 @@
+// solver scalability benchmark, feeds a solver synthetic instances of a given size and measures its think time and memory
+
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "demand_model.h"
+#include "reactive.h"
+
+
+// Header and demand of a synthetic instance
+// The costs follow the generator's cost formula with random worker counts, hourly rates and cost exponents. Every
+// machine-week gets a random share of the working hours of pattern 7, which the demand model carries over between
+// weeks like the judge's left-justified schedule.
+DemandModel CreateInstance( int resourceN, int week, int changeLimit, int reactiveN, unsigned int seed )
+{
+    std::mt19937 random( seed );
+    auto Uniform = [&random] ( double lo, double hi ) { return std::uniform_real_distribution<double>( lo, hi )( random ); };
+
+    const int typeN = static_cast<int>( Calendar.totalTime.size() );
+    const double addCostHoliday = 1.2 / 5.0 * 2.0;
+
+    vector<string> header;
+    header.emplace_back( to_string( week ) + ' ' + to_string( resourceN ) + ' ' + to_string( changeLimit ) + ' ' + to_string( reactiveN ) );
+    for( int i = 0; i < resourceN; i++ )
+    {
+        const int workerN = static_cast<int>( Uniform( 1, 4 ) );
+        const int costPerHour = static_cast<int>( Uniform( 1000, 1500 ) );
+        const int costPerHourNight = costPerHour + static_cast<int>( Uniform( 0, 300 ) );
+        const double costRatio = Uniform( 1.0, 1.05 );
+
+        vector<int> costA( typeN );
+        for( int k = 2; k < typeN; k++ )
+            costA[k] = static_cast<int>( ( Calendar.totalTimeA[k] * workerN * costPerHour + Calendar.totalTimeB[k] * workerN * costPerHourNight ) * pow( costRatio, Calendar.totalTime[k] ) );
+        costA[0] = static_cast<int>( costA[2] * Uniform( 0.0, 0.3 ) );
+        costA[1] = static_cast<int>( costA[2] * Uniform( 0.3, 0.6 ) );
+
+        for( int k = 0; k < typeN; k++ )
+            header.emplace_back( to_string( costA[k] ) + ' ' + to_string( static_cast<int>( costA[k] * addCostHoliday ) ) );
+    }
+
+    DemandModel model;
+    model.ReadHeader( header );
+
+    const int capacity = DemandModel::GetCapacity( '7', '7' );
+    for( int i = 0; i < resourceN; i++ )
+    {
+        const double machineLoad = Uniform( 0.3, 0.9 );
+        for( int j = 0; j < week; j++ )
+            model.demand[i * week + j] = capacity * std::clamp( machineLoad + Uniform( -0.2, 0.2 ), 0.0, 1.0 );
+    }
+
+    return model;
+}
+
+string FormatHeader( const DemandModel& model )
+{
+    stringstream ss;
+    ss << model.week << ' ' << model.resourceN << ' ' << model.resCalendarChangeLimitN << ' ' << model.reactiveN << '\n';
+    for( int i = 0; i < model.resourceN; i++ )
+        for( size_t k = 0; k < model.costTypeA[i].size(); k++ )
+            ss << model.costTypeA[i][k] << ' ' << model.costTypeB[i][k] << '\n';
+    return ss.str();
+}
+
+// Resident and peak resident set size of a process in KiB, from /proc/<pid>/status. The solver is exec'd directly with
+// both transports, so these are its own, unlike ru_maxrss, which also covers the image the solver was forked from.
+pair<long, long> GetMemory( pid_t pid )
+{
+    ifstream in( "/proc/" + to_string( pid ) + "/status" );
+    long rss = 0, hwm = 0;
+    for( string line; getline( in, line ); )
+    {
+        if( line.rfind( "VmRSS:", 0 ) == 0 ) rss = stol( line.substr( 6 ) );
+        if( line.rfind( "VmHWM:", 0 ) == 0 ) hwm = stol( line.substr( 6 ) );
+    }
+    return { rss, hwm };
+}
+
+struct SizeResult
+{
+    int resourceN;
+    int week;
+    int interactions = 0; // completed interactions
+    double firstThinkMs = 0.0; // includes the solver's startup
+    double meanThinkMs = 0.0; // of the interactions after the first
+    double maxThinkMs = 0.0;
+    long peakRssKb = 0; // at the end of an interaction
+};
+
+// Runs the solver on one synthetic instance, prints one line per interaction
+SizeResult RunSize( const string& command, bool sharedMemory, int resourceN, int week, int changeLimit, int reactiveN,
+                    unsigned int seed )
+{
+    SizeResult result{ resourceN, week };
+    DemandModel model = CreateInstance( resourceN, week, changeLimit, reactiveN, seed );
+
+    if( reactive_start( command, sharedMemory ) != 0 ) exit( 1 );
+
+    string message = FormatHeader( model );
+    double totalThinkMs = 0.0;
+    for( int k = 0; k < reactiveN; k++ )
+    {
+        // think time: from handing the solver the previous reply until it has written its whole calendar
+        const auto start = chrono::steady_clock::now();
+        reactive_write( message );
+
+        vector<string> calendar;
+        for( int i = 0; i < resourceN; i++ )
+        {
+            string s = reactive_read( 2 * week + 2 );
+            if( !s.empty() && s.back() == '\n' ) s.pop_back();
+            calendar.emplace_back( s );
+        }
+        const double thinkMs = chrono::duration<double, milli>( chrono::steady_clock::now() - start ).count();
+
+        for( const string& s : calendar )
+        {
+            if( s.size() != static_cast<size_t>( week ) * 2 || s.find_first_not_of( "123456789" ) != string::npos )
+            {
+                cerr << resourceN << 'x' << week << ": invalid calendar in interaction " << k + 1 << ", stopping" << endl;
+                reactive_end();
+                return result;
+            }
+        }
+
+        // the solver is waiting for the reply now, so this is its memory after the interaction
+        auto [rss, hwm] = GetMemory( __reactive_pid );
+        cout << resourceN << '\t' << week << '\t' << k + 1 << '\t' << fixed << setprecision( 3 ) << thinkMs << '\t' << rss << '\t' << hwm << '\n';
+
+        result.interactions++;
+        if( k == 0 ) result.firstThinkMs = thinkMs;
+        else totalThinkMs += thinkMs;
+        result.maxThinkMs = max( result.maxThinkMs, thinkMs );
+        result.peakRssKb = max( result.peakRssKb, hwm );
+
+        message = model.Evaluate( calendar ).Format();
+        if( k + 1 == reactiveN ) reactive_write( message );
+    }
+
+    reactive_end();
+    result.meanThinkMs = totalThinkMs / max( 1, result.interactions - 1 );
+    return result;
+}
+
+int main( int argc, char** argv )
+{
+    if( argc <= 1 )
+    {
+        cerr << "usage: " << argv[0] << " <command> [-sizes MxW,...] [-interactions n] [-changeLimit n] [-seed n] [-transport pipe|shm] [-solver-log file]\n";
+        cerr << "  -sizes: machines x weeks of the synthetic instances, default 20x16,100x26,500x52\n";
+        cerr << "  prints machines, weeks, interaction, think time in ms, RSS and peak RSS in KiB per interaction\n";
+        cerr << "  the mean think time and the exponents leave out interaction 1, which includes the solver's startup\n";
+        return 0;
+    }
+
+    string sizes = "20x16,100x26,500x52", solverLogFileName = "/dev/null";
+    int reactiveN = 50, changeLimit = 8;
+    unsigned int seed = 1;
+    bool sharedMemory = false; // shm needs solvers built with SHM_TRANSPORT
+    for( int i = 2; i < argc; i += 2 )
+    {
+        string option = argv[i];
+        if( i + 1 >= argc )
+        {
+            cerr << "missing value for option: " << option << '\n';
+            return 1;
+        }
+
+        string value = argv[i + 1];
+        if( option == "-sizes" ) sizes = value;
+        else if( option == "-interactions" ) reactiveN = stoi( value );
+        else if( option == "-changeLimit" ) changeLimit = stoi( value );
+        else if( option == "-seed" ) seed = stoul( value );
+        else if( option == "-solver-log" ) solverLogFileName = value;
+        else if( option == "-transport" )
+        {
+            if( value != "pipe" && value != "shm" )
+            {
+                cerr << "unknown transport: " << value << '\n';
+                return 1;
+            }
+            sharedMemory = value == "shm";
+        }
+        else
+        {
+            cerr << "unknown option: " << option << '\n';
+            return 1;
+        }
+    }
+
+    vector<pair<int, int>> sizeList;
+    {
+        stringstream ss( sizes );
+        for( string size; getline( ss, size, ',' ); )
+        {
+            const size_t x = size.find( 'x' );
+            if( x == string::npos )
+            {
+                cerr << "invalid size: " << size << '\n';
+                return 1;
+            }
+            sizeList.emplace_back( stoi( size.substr( 0, x ) ), stoi( size.substr( x + 1 ) ) );
+        }
+    }
+
+    // the solver inherits stderr, keep its log out of the report and out of the timing of the terminal
+    const int stderrCopy = dup( 2 );
+    const int solverLog = open( solverLogFileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+    if( solverLog < 0 )
+    {
+        cerr << "cannot open solver log file: " << solverLogFileName << endl;
+        return 1;
+    }
+
+    cout << "machines\tweeks\tinteraction\tthinkMs\trssKb\tpeakRssKb\n";
+
+    vector<SizeResult> results;
+    for( auto [resourceN, week] : sizeList )
+    {
+        cout.flush(); // the forked child exits through the stdio buffers
+        dup2( solverLog, 2 );
+        results.push_back( RunSize( argv[1], sharedMemory, resourceN, week, changeLimit, reactiveN, seed ) );
+        dup2( stderrCopy, 2 );
+    }
+    close( solverLog );
+    cout.flush();
+
+    // Growth exponent of the think time per interaction in the number of machine-weeks between consecutive sizes,
+    // about 1 for linear and 2 for quadratic code paths
+    cerr << fixed << setprecision( 3 );
+    for( size_t i = 0; i < results.size(); i++ )
+    {
+        const SizeResult& r = results[i];
+        cerr << r.resourceN << 'x' << r.week << ": " << r.interactions << " interactions, first think time " << r.firstThinkMs
+             << " ms, mean of the others " << r.meanThinkMs << " ms, max " << r.maxThinkMs << " ms, peak RSS " << r.peakRssKb << " KiB";
+        if( i > 0 && r.interactions > 1 && results[i - 1].interactions > 1 )
+        {
+            const SizeResult& p = results[i - 1];
+            const double cells = log( static_cast<double>( r.resourceN ) * r.week / ( static_cast<double>( p.resourceN ) * p.week ) );
+            cerr << ", think time exponent " << log( r.meanThinkMs / p.meanThinkMs ) / cells
+                 << ", memory exponent " << log( static_cast<double>( r.peakRssKb ) / p.peakRssKb ) / cells;
+        }
+        cerr << '\n';
+    }
+    return 0;
+}
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+
+// Rows of one block of the trace, see GanttTraceWriter
+struct GanttTraceRows
+{
+    std::vector<int32_t> op;
+    std::vector<uint8_t> proc;
+    std::vector<int16_t> res;
+    std::vector<int32_t> start;
+    std::vector<int32_t> end;
+    std::vector<uint8_t> late;
+
+    size_t Size() const
+    {
+        return op.size();
+    }
+
+    void Clear()
+    {
+        Truncate( 0 );
+    }
+
+    void Truncate( size_t n )
+    {
+        op.resize( n );
+        proc.resize( n );
+        res.resize( n );
+        start.resize( n );
+        end.resize( n );
+        late.resize( n );
+    }
+
+    void Add( int opNo, int procIndex, int resource, int startTime, int endTime, bool isLate )
+    {
+        op.push_back( opNo );
+        proc.push_back( static_cast<uint8_t>( procIndex ) );
+        res.push_back( static_cast<int16_t>( resource ) );
+        start.push_back( startTime );
+        end.push_back( endTime );
+        late.push_back( isLate );
+    }
+
+    void Append( const GanttTraceRows& other )
+    {
+        op.insert( op.end(), other.op.begin(), other.op.end() );
+        proc.insert( proc.end(), other.proc.begin(), other.proc.end() );
+        res.insert( res.end(), other.res.begin(), other.res.end() );
+        start.insert( start.end(), other.start.begin(), other.start.end() );
+        end.insert( end.end(), other.end.begin(), other.end.end() );
+        late.insert( late.end(), other.late.begin(), other.late.end() );
+    }
+};
+
+// Per-operation Gantt trace of the simulation
+//
+// File layout (little endian)
+//   header : char[4] "AGNT", int32 version, int32 resourceN, int32 week, int32 operationN
+//   block  : int32 interaction, int32 rowN, followed by the columns
+//            int32 op[rowN], uint8 proc[rowN], int16 res[rowN], int32 start[rowN], int32 end[rowN], uint8 late[rowN]
+// One block is written per interaction, so memory stays bounded by a single simulation. On big endian hosts the
+// values are byte-swapped on the way out.
+class GanttTraceWriter
+{
+private:
+    FILE* file = nullptr;
+    int interaction = 0;
+    GanttTraceRows rows;
+    std::vector<unsigned char> swapped; // reused by WriteValues on big endian hosts
+
+    template<class T>
+    void WriteValues( const T* values, size_t n )
+    {
+        if constexpr( std::endian::native == std::endian::little || sizeof( T ) == 1 )
+        {
+            fwrite( values, sizeof( T ), n, file );
+        }
+        else
+        {
+            swapped.resize( n * sizeof( T ) );
+            memcpy( swapped.data(), values, swapped.size() );
+            for( size_t i = 0; i < swapped.size(); i += sizeof( T ) ) std::reverse( swapped.begin() + i, swapped.begin() + i + sizeof( T ) );
+            fwrite( swapped.data(), 1, swapped.size(), file );
+        }
+    }
+
+    template<class T>
+    void WriteColumn( const std::vector<T>& column )
+    {
+        WriteValues( column.data(), column.size() );
+    }
+
+public:
+    static constexpr int32_t VERSION = 1;
+
+    GanttTraceWriter() = default;
+    GanttTraceWriter( const GanttTraceWriter& ) = delete;
+    GanttTraceWriter& operator=( const GanttTraceWriter& ) = delete;
+
+    ~GanttTraceWriter()
+    {
+        Close();
+    }
+
+    bool Open( const std::string& fileName, int resourceN, int week, int operationN )
+    {
+        file = fopen( fileName.c_str(), "wb" );
+        if( file == nullptr ) return false;
+
+        setvbuf( file, nullptr, _IOFBF, 1 << 20 );
+
+        const int32_t header[] = { VERSION, resourceN, week, operationN };
+        fwrite( "AGNT", 1, 4, file );
+        WriteValues( header, 4 );
+        fflush( file ); // nothing may be left buffered when the solver process is forked
+        return true;
+    }
+
+    void Close()
+    {
+        if( file != nullptr )
+        {
+            fclose( file );
+            file = nullptr;
+        }
+    }
+
+    // the rows of the current block
+    GanttTraceRows& Rows()
+    {
+        return rows;
+    }
+
+    void BeginInteraction()
+    {
+        rows.Clear();
+    }
+
+    void Add( int opNo, int procIndex, int resource, int startTime, int endTime, bool isLate )
+    {
+        rows.Add( opNo, procIndex, resource, startTime, endTime, isLate );
+    }
+
+    void EndInteraction()
+    {
+        const int32_t header[] = { interaction++, static_cast<int32_t>( rows.Size() ) };
+        WriteValues( header, 2 );
+
+        WriteColumn( rows.op );
+        WriteColumn( rows.proc );
+        WriteColumn( rows.res );
+        WriteColumn( rows.start );
+        WriteColumn( rows.end );
+        WriteColumn( rows.late );
+    }
+};
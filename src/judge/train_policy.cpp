@@ -0,0 +1,362 @@
+// offline training of the solver's optimization ranking model
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include "judge.h"
+
+// The solver is compiled into this binary and talks to the judge directly, without a process per episode. Its headers
+// are all included above, so the includes inside the namespace are no-ops.
+#pragma push_macro( "LOCAL" )
+#undef LOCAL
+#define SOLVER_NO_MAIN
+namespace solver
+{
+#include "../solvers/v23.cpp"
+}
+#undef log
+#pragma pop_macro( "LOCAL" )
+
+using Weights = std::array<double, solver::FEATURE_COUNT>;
+
+
+// Features of one selected optimization and whether the next reply improved on the best score
+struct Sample
+{
+    int file;
+    int episode;
+    int interaction;
+    bool success;
+    vector<double> features;
+};
+
+// Runs the solver on one input file against the in-process judge and returns its score
+long long RunEpisode( const string& inputFileName, int file, int episode, const Weights& weights, double exploration,
+                      vector<Sample>& samples )
+{
+    Judge J;
+    {
+        ifstream in( inputFileName );
+        J.Input( in );
+    }
+
+    auto [reactiveN, week, resourceN, costTypeA, costTypeB, changeLimit] = J.reactive_init_input();
+
+    solver::Solver S( week, resourceN, changeLimit, reactiveN );
+    S.modelWeights = weights;
+    S.explorationRate = episode == 0 ? 0.0 : exploration; // episode 0 is the greedy policy
+    S.random.seed( file * 1'000'003 + episode );
+
+    solver::State state;
+    state.machines.resize( resourceN );
+    for( int i = 0; i < resourceN; i++ )
+    {
+        auto& machine = state.machines[i];
+        machine.weekDayPatterns.resize( week );
+        machine.weekEndPatterns.resize( week );
+        for( int j = 0; j < 9; j++ )
+        {
+            machine.weekDayPatternCosts.push_back( costTypeA[{i, j}] );
+            machine.weekEndPatternCosts.push_back( costTypeB[{i, j}] );
+        }
+    }
+
+    S.currentInteraction = 1;
+    S.setInitialPatterns( state );
+
+    long long bestScore = 0;
+    std::optional<vector<double>> pending;
+    for( int k = 0; k < reactiveN; k++ )
+    {
+        vector<string> input( resourceN );
+        for( int i = 0; i < resourceN; i++ )
+        {
+            for( int j = 0; j < week; j++ )
+            {
+                input[i] += char( '0' + state.machines[i].weekDayPatterns[j] );
+                input[i] += char( '0' + state.machines[i].weekEndPatterns[j] );
+            }
+        }
+
+        auto [score, let, chLimVioCnt, loadRate, letOpCount] = J.reactive( input );
+        bestScore = max( bestScore, score );
+
+        state.score = score;
+        state.noViolations = chLimVioCnt;
+        state.noDelays = let;
+        for( auto& e : loadRate )
+        {
+            auto& machine = state.machines[e.first.first];
+            machine.loads.resize( week );
+            machine.noDelays.resize( week );
+
+            // what the solver would parse from the judge's text reply
+            machine.loads[e.first.second] = stod( to_string( e.second ) );
+            machine.noDelays[e.first.second] = stoi( to_string( letOpCount[e.first] ).substr( 0, 5 ) );
+        }
+
+        if( pending.has_value() )
+        {
+            samples.push_back( { file, episode, k, state.score > S.bestState.score, std::move( *pending ) } );
+            pending.reset();
+        }
+
+        if( k == reactiveN - 1 ) break;
+
+        S.currentInteraction = k + 2;
+        S.refine( state );
+        pending = S.selectedFeatures;
+    }
+
+    return bestScore;
+}
+
+// Solves A x = b by Gaussian elimination with partial pivoting
+vector<double> Solve( vector<vector<double>> A, vector<double> b )
+{
+    const int n = static_cast<int>( b.size() );
+    for( int c = 0; c < n; c++ )
+    {
+        int pivot = c;
+        for( int r = c + 1; r < n; r++ )
+            if( fabs( A[r][c] ) > fabs( A[pivot][c] ) ) pivot = r;
+        swap( A[c], A[pivot] );
+        swap( b[c], b[pivot] );
+
+        for( int r = c + 1; r < n; r++ )
+        {
+            const double f = A[r][c] / A[c][c];
+            for( int k = c; k < n; k++ ) A[r][k] -= f * A[c][k];
+            b[r] -= f * b[c];
+        }
+    }
+
+    vector<double> x( n );
+    for( int r = n - 1; r >= 0; r-- )
+    {
+        double s = b[r];
+        for( int k = r + 1; k < n; k++ ) s -= A[r][k] * x[k];
+        x[r] = s / A[r][r];
+    }
+    return x;
+}
+
+// L2-regularised logistic regression by Newton's method, the bias (feature 0) is not regularised
+Weights Fit( const vector<Sample>& samples, double l2 )
+{
+    const int n = solver::FEATURE_COUNT;
+    Weights w{};
+
+    for( int iteration = 0; iteration < 25; iteration++ )
+    {
+        vector<vector<double>> H( n, vector<double>( n, 0.0 ) );
+        vector<double> g( n, 0.0 );
+        for( int i = 1; i < n; i++ )
+        {
+            H[i][i] += l2;
+            g[i] += l2 * w[i];
+        }
+        H[0][0] += 1e-9;
+
+        for( const auto& sample : samples )
+        {
+            double z = 0.0;
+            for( int i = 0; i < n; i++ ) z += w[i] * sample.features[i];
+            const double p = 1.0 / ( 1.0 + exp( -z ) );
+            const double r = p * ( 1.0 - p );
+
+            for( int i = 0; i < n; i++ )
+            {
+                g[i] += ( p - sample.success ) * sample.features[i];
+                for( int j = 0; j < n; j++ ) H[i][j] += r * sample.features[i] * sample.features[j];
+            }
+        }
+
+        const vector<double> step = Solve( H, g );
+        double change = 0.0;
+        for( int i = 0; i < n; i++ )
+        {
+            w[i] -= step[i];
+            change = max( change, fabs( step[i] ) );
+        }
+        if( change < 1e-9 ) break;
+    }
+
+    return w;
+}
+
+double LogLoss( const vector<Sample>& samples, const Weights& w )
+{
+    double loss = 0.0;
+    for( const auto& sample : samples )
+    {
+        double z = 0.0;
+        for( int i = 0; i < solver::FEATURE_COUNT; i++ ) z += w[i] * sample.features[i];
+        const double p = std::clamp( 1.0 / ( 1.0 + exp( -z ) ), 1e-12, 1.0 - 1e-12 );
+        loss -= sample.success ? log( p ) : log( 1.0 - p );
+    }
+    return loss / max<size_t>( 1, samples.size() );
+}
+
+// Replaces the block between "// BEGIN MODEL" and "// END MODEL" in the solver source
+bool Export( const string& solverFileName, const Weights& w )
+{
+    vector<string> lines;
+    {
+        ifstream in( solverFileName );
+        if( !in ) return false;
+        for( string line; getline( in, line ); ) lines.push_back( line );
+    }
+
+    auto begin = find( lines.begin(), lines.end(), "// BEGIN MODEL" );
+    auto end = find( begin, lines.end(), "// END MODEL" );
+    if( begin == lines.end() || end == lines.end() ) return false;
+
+    stringstream ss;
+    ss << setprecision( 6 );
+    for( int i = 0; i < solver::FEATURE_COUNT; i++ ) ss << ( i == 0 ? "" : ", " ) << w[i];
+
+    vector<string> block = {
+        "constexpr std::array<double, FEATURE_COUNT> MODEL_WEIGHTS = {",
+        "        " + ss.str(),
+        "};"
+    };
+    lines.erase( begin + 1, end );
+    lines.insert( find( lines.begin(), lines.end(), "// BEGIN MODEL" ) + 1, block.begin(), block.end() );
+
+    ofstream out( solverFileName );
+    for( const auto& line : lines ) out << line << '\n';
+    return static_cast<bool>( out );
+}
+
+int main( int argc, char* argv[] )
+{
+    if( argc <= 1 )
+    {
+        cerr << "usage: " << argv[0] << " [-episodes n] [-exploration rate] [-rounds n] [-l2 lambda] [-threads n]"
+             << " [-samples samples-file] [-export solver-file] input-file...\n";
+        return 0;
+    }
+
+    int episodes = 4;
+    double exploration = 0.2;
+    int rounds = 2;
+    double l2 = 1.0;
+    int threads = max( 1u, thread::hardware_concurrency() );
+    string samplesFileName, exportFileName;
+    vector<string> inputFileNames;
+
+    for( int i = 1; i < argc; i++ )
+    {
+        string option = argv[i];
+        if( option[0] != '-' )
+        {
+            inputFileNames.push_back( option );
+            continue;
+        }
+
+        if( i + 1 >= argc )
+        {
+            cerr << "missing value for option: " << option << '\n';
+            return 1;
+        }
+
+        string value = argv[++i];
+        if( option == "-episodes" ) episodes = stoi( value );
+        else if( option == "-exploration" ) exploration = stod( value );
+        else if( option == "-rounds" ) rounds = stoi( value );
+        else if( option == "-l2" ) l2 = stod( value );
+        else if( option == "-threads" ) threads = stoi( value );
+        else if( option == "-samples" ) samplesFileName = value;
+        else if( option == "-export" ) exportFileName = value;
+        else
+        {
+            cerr << "unknown option: " << option << '\n';
+            return 1;
+        }
+    }
+
+    for( const auto& inputFileName : inputFileNames )
+    {
+        if( !ifstream( inputFileName ) )
+        {
+            cerr << "cannot open input file " << inputFileName << endl;
+            return 1;
+        }
+    }
+
+    // Every round collects episodes with the current model and refits it on the samples of all rounds so far
+    Weights weights = solver::MODEL_WEIGHTS;
+    vector<Sample> samples;
+    for( int round = 0; round < rounds; round++ )
+    {
+        const int jobN = static_cast<int>( inputFileNames.size() ) * episodes;
+        atomic<int> nextJob = 0;
+        atomic<long long> greedyScore = 0;
+        mutex samplesMutex;
+
+        auto Work = [&] ()
+        {
+            vector<Sample> local;
+            for( int job; ( job = nextJob++ ) < jobN; )
+            {
+                const int file = job / episodes, episode = job % episodes;
+                const long long score = RunEpisode( inputFileNames[file], file, round * episodes + episode, weights,
+                                                    exploration, local );
+                if( episode == 0 ) greedyScore += score;
+            }
+
+            lock_guard<mutex> lock( samplesMutex );
+            samples.insert( samples.end(), local.begin(), local.end() );
+        };
+
+        vector<thread> workers;
+        for( int i = 0; i < threads; i++ ) workers.emplace_back( Work );
+        for( auto& worker : workers ) worker.join();
+
+        weights = Fit( samples, l2 );
+
+        const auto successN = count_if( samples.begin(), samples.end(), [] ( const Sample& s ) { return s.success; } );
+        cerr << "Round " << round + 1 << ": greedy score = " << greedyScore << ", samples = " << samples.size()
+             << ", success rate = " << static_cast<double>( successN ) / max<size_t>( 1, samples.size() )
+             << ", log loss = " << LogLoss( samples, weights ) << endl;
+    }
+
+    if( !samplesFileName.empty() )
+    {
+        ofstream out( samplesFileName );
+        out << "file\tepisode\tinteraction\tsuccess";
+        for( int i = 0; i < solver::FEATURE_COUNT; i++ ) out << "\tf" << i;
+        out << '\n';
+        for( const auto& sample : samples )
+        {
+            out << inputFileNames[sample.file] << '\t' << sample.episode << '\t' << sample.interaction << '\t' << sample.success;
+            for( double f : sample.features ) out << '\t' << f;
+            out << '\n';
+        }
+    }
+
+    cout << setprecision( 6 );
+    for( int i = 0; i < solver::FEATURE_COUNT; i++ ) cout << ( i == 0 ? "" : " " ) << weights[i];
+    cout << '\n';
+
+    if( !exportFileName.empty() && !Export( exportFileName, weights ) )
+    {
+        cerr << "cannot export the model to " << exportFileName << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -1,3 +1,4 @@
+#include <cstdlib>
 #include <iostream>
 #include <vector>
 
@@ -28,26 +29,182 @@ struct State {
     int noDelays = 0;
 };
 
+enum class StateField {
+    WEEK_DAY_PATTERN,
+    WEEK_END_PATTERN,
+    LOAD,
+    NO_DELAYS,
+    OPTIMIZING_MACHINE,
+    SCORE,
+    NO_VIOLATIONS,
+    TOTAL_NO_DELAYS
+};
+
+struct StateChange {
+    StateField field;
+    int machine;
+    int week;
+    double from;
+    double to;
+
+    void set(State &state, double value) const {
+        switch (field) {
+            case StateField::WEEK_DAY_PATTERN:
+                state.machines[machine].weekDayPatterns[week] = (int) value;
+                break;
+            case StateField::WEEK_END_PATTERN:
+                state.machines[machine].weekEndPatterns[week] = (int) value;
+                break;
+            case StateField::LOAD:
+                state.machines[machine].loads[week] = value;
+                break;
+            case StateField::NO_DELAYS:
+                state.machines[machine].noDelays[week] = (int) value;
+                break;
+            case StateField::OPTIMIZING_MACHINE:
+                state.optimizingMachine = (int) value;
+                break;
+            case StateField::SCORE:
+                state.score = (long) value;
+                break;
+            case StateField::NO_VIOLATIONS:
+                state.noViolations = (int) value;
+                break;
+            case StateField::TOTAL_NO_DELAYS:
+                state.noDelays = (int) value;
+                break;
+        }
+    }
+};
+
+// Stores the states of all interactions as one base snapshot plus the changes between consecutive states
+struct StateHistory {
+    State current;
+
+    State base;
+    State last;
+    std::vector<std::vector<StateChange>> changes;
+
+    int committed = 0;
+
+    [[nodiscard]] int size() const {
+        return committed + 1;
+    }
+
+    [[nodiscard]] const State &previous() const {
+        return last;
+    }
+
+    void push() {
+        if (committed == 0) {
+            base = current;
+            last = current;
+        } else {
+            changes.push_back(getChanges(last, current));
+
+            for (const auto &change : changes.back()) {
+                change.set(last, change.to);
+            }
+        }
+
+        committed++;
+
+#ifdef LOCAL
+        pushed.push_back(current);
+        check();
+#endif
+    }
+
+#ifdef LOCAL
+    // the states as they were pushed, to check get() against
+    std::vector<State> pushed;
+
+    // One index below the middle is replayed forwards from base, one above it backwards through the from values
+    void check() const {
+        for (int index : {(committed - 1) / 3, 2 * (committed - 1) / 3}) {
+            if (!getChanges(get(index), pushed[index]).empty()) {
+                std::cerr << "StateHistory: get(" << index << ") differs from the state pushed at interaction "
+                          << index << std::endl;
+                std::abort();
+            }
+        }
+    }
+#endif
+
+    [[nodiscard]] State get(int index) const {
+        if (index < committed - 1 - index) {
+            State state = base;
+            move(state, 0, index);
+            return state;
+        }
+
+        State state = last;
+        move(state, committed - 1, index);
+        return state;
+    }
+
+    void move(State &state, int from, int to) const {
+        for (int i = from; i < to; i++) {
+            for (const auto &change : changes[i]) {
+                change.set(state, change.to);
+            }
+        }
+
+        for (int i = from - 1; i >= to; i--) {
+            for (auto it = changes[i].rbegin(); it != changes[i].rend(); it++) {
+                it->set(state, it->from);
+            }
+        }
+    }
+
+    [[nodiscard]] static std::vector<StateChange> getChanges(const State &from, const State &to) {
+        std::vector<StateChange> result;
+
+        auto add = [&](StateField field, int machine, int week, double fromValue, double toValue) {
+            if (fromValue != toValue) {
+                result.push_back({field, machine, week, fromValue, toValue});
+            }
+        };
+
+        for (int i = 0; i < from.machines.size(); i++) {
+            const auto &fromMachine = from.machines[i];
+            const auto &toMachine = to.machines[i];
+
+            for (int j = 0; j < fromMachine.weekDayPatterns.size(); j++) {
+                add(StateField::WEEK_DAY_PATTERN, i, j, fromMachine.weekDayPatterns[j], toMachine.weekDayPatterns[j]);
+                add(StateField::WEEK_END_PATTERN, i, j, fromMachine.weekEndPatterns[j], toMachine.weekEndPatterns[j]);
+                add(StateField::LOAD, i, j, fromMachine.loads[j], toMachine.loads[j]);
+                add(StateField::NO_DELAYS, i, j, fromMachine.noDelays[j], toMachine.noDelays[j]);
+            }
+        }
+
+        add(StateField::OPTIMIZING_MACHINE, -1, -1, from.optimizingMachine, to.optimizingMachine);
+        add(StateField::SCORE, -1, -1, from.score, to.score);
+        add(StateField::NO_VIOLATIONS, -1, -1, from.noViolations, to.noViolations);
+        add(StateField::TOTAL_NO_DELAYS, -1, -1, from.noDelays, to.noDelays);
+
+        return result;
+    }
+};
+
 struct Solver {
     int noWeeks;
     int noMachines;
     int maxChanges;
     int noInteractions;
 
-    std::vector<State> states;
+    StateHistory states;
 
     Solver(int noWeeks, int noMachines, int maxChanges, int noInteractions)
             : noWeeks(noWeeks),
               noMachines(noMachines),
               maxChanges(maxChanges),
               noInteractions(noInteractions) {
-        State initialState;
-        initialState.machines.resize(noMachines);
-        states.push_back(initialState);
+        states.current.machines.resize(noMachines);
     }
 
     void setInitialPatterns() {
-        auto &state = states[0];
+        auto &state = states.current;
 
         for (int i = 0; i < noMachines; i++) {
             auto &machine = state.machines[i];
@@ -60,8 +217,8 @@ struct Solver {
     }
 
     void refine() {
-        auto &previousState = states[states.size() - 2];
-        auto &currentState = states[states.size() - 1];
+        const auto &previousState = states.previous();
+        auto &currentState = states.current;
 
         if (currentState.optimizingMachine >= noMachines) {
             return;
@@ -114,7 +271,7 @@ int main() {
     Solver solver(noWeeks, noMachines, maxChanges, noInteractions);
 
     for (int i = 0; i < noMachines; i++) {
-        auto &machine = solver.states[0].machines[i];
+        auto &machine = solver.states.current.machines[i];
 
         machine.weekDayPatterns.resize(noWeeks);
         machine.weekEndPatterns.resize(noWeeks);
@@ -136,7 +293,7 @@ int main() {
     for (int i = 0; i < noInteractions; i++) {
         log << "Interaction " << (i + 1) << std::endl;
 
-        auto &currentState = solver.states[i];
+        auto &currentState = solver.states.current;
 
         for (int j = 0; j < noMachines; j++) {
             auto &machine = currentState.machines[j];
@@ -170,8 +327,7 @@ int main() {
             break;
         }
 
-        State nextState(currentState);
-        solver.states.push_back(nextState);
+        solver.states.push();
 
         solver.refine();
     }
@@ -13,6 +13,10 @@
 #define log if (false) std::cerr
 #endif
 
+#ifndef ALLOCATION_PHASE
+#define ALLOCATION_PHASE(name)
+#endif
+
 struct Machine {
     std::vector<int> weekDayPatterns;
     std::vector<int> weekEndPatterns;
@@ -171,6 +175,8 @@ struct Solver {
     }
 
     void refine(State &state) {
+        ALLOCATION_PHASE("refine");
+
         if (state.score > bestState.score) {
             bestState = state;
         }
@@ -311,6 +317,8 @@ struct Solver {
     }
 
     [[nodiscard]] std::vector<Optimization> generateOptimizations(const State &state) const {
+        ALLOCATION_PHASE("generateOptimizations");
+
         std::vector<Optimization> optimizations;
 
         std::vector<OptimizationPart> reduceGlobalParts;
@@ -640,6 +648,8 @@ int main() {
     solver.setInitialPatterns(state);
 
     for (int i = 0; i < noInteractions; i++) {
+        ALLOCATION_PHASE("interaction");
+
         for (int j = 0; j < noMachines; j++) {
             auto &machine = state.machines[j];
 
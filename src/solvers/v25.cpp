@@ -0,0 +1,1353 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#ifdef LOCAL
+#define log if (true) std::cerr
+#else
+#define log if (false) std::cerr
+#endif
+
+#ifndef ALLOCATION_PHASE
+#define ALLOCATION_PHASE(name)
+#endif
+
+// Working hours per day of patterns 1-9
+const int PATTERN_HOURS[] = {0, 3, 5, 8, 10, 12, 14, 16, 18};
+
+// Logistic model of the probability that an optimization works, over the features of Solver::getFeatures().
+// Optimizations are ranked by probability^MODEL_EXPONENT * cost improvement, ranking by the plain expected improvement
+// prefers small safe optimizations too much. Fitted offline by train_policy, which replaces the block between the
+// markers.
+constexpr int FEATURE_COUNT = 14;
+constexpr double MODEL_EXPONENT = 0.25;
+
+// BEGIN MODEL
+constexpr std::array<double, FEATURE_COUNT> MODEL_WEIGHTS = {
+        1.01431, -0.606143, -0.347869, -0.751487, 0.0244662, -0.821762, 2.50279, -2.7668, -2.30551, 1.33904, 0.723944, 2.82174, -0.822707, -2.06529
+};
+// END MODEL
+
+// Rollout planner, see Solver::plan()
+constexpr int PLAN_FIRST_MOVES = 8;
+constexpr int PLAN_POOL_SIZE = 48;
+constexpr int PLAN_ROLLOUTS = 32;
+
+// The rollouts overrate reorderings, only deviate from the priority order if it is clearly better
+constexpr double PLAN_MARGIN = 0.2;
+
+// A failed optimization makes the optimizations on the same machine-weeks less likely to work
+constexpr double FAILURE_CORRELATION = 0.7;
+
+// Weight of the model's probability against the outcomes observed during the run, in trials
+constexpr double PRIOR_TRIALS = 4.0;
+
+// Demand probes, see Solver::shouldProbe()
+// A week with a load at or above SATURATED_LOAD only tells that its demand is at least its capacity. A probe submits
+// the current patterns with the weekday pattern of such weeks raised by PROBE_PATTERN_STEPS, which measures their
+// demand. The probe's own score does not matter, the best score so far is kept.
+constexpr double SATURATED_LOAD = 0.999;
+constexpr int PROBE_PATTERN_STEPS = 2;
+constexpr int PROBE_HORIZON = 8;
+
+// Fraction of the failures of optimizations over saturated weeks that knowing their demand would avoid
+constexpr double PROBE_INFORMATIVENESS = 0.5;
+
+// Avoidable failures needed to probe, above the break-even of 1 since a probe also delays the optimizations
+constexpr double PROBE_THRESHOLD = 3.0;
+
+// Threads that are started once and run the tasks of one call to run() at a time, plan() uses them in every
+// interaction. The calling thread takes part, so a pool of size 1 runs the tasks inline.
+class WorkerPool {
+public:
+    explicit WorkerPool(int size) {
+        for (int t = 1; t < size; t++) {
+            threads.emplace_back([this]() { work(); });
+        }
+    }
+
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool &operator=(const WorkerPool &) = delete;
+
+    ~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+
+        for (auto &thread : threads) {
+            thread.join();
+        }
+    }
+
+    // Calls task(i) for every i in [0, noTasks) and returns when all calls have finished
+    void run(int noTasks, const std::function<void(int)> &task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            current = &task;
+            tasks = noTasks;
+            next = 0;
+            busy = (int) threads.size();
+            generation++;
+        }
+        wake.notify_all();
+
+        drain();
+
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [this]() { return busy == 0; });
+        current = nullptr;
+    }
+
+private:
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable finished;
+
+    const std::function<void(int)> *current = nullptr;
+    std::atomic<int> next = 0;
+    int tasks = 0;
+    int busy = 0;
+    long generation = 0;
+    bool stopping = false;
+
+    void drain() {
+        for (int i = next++; i < tasks; i = next++) {
+            (*current)(i);
+        }
+    }
+
+    void work() {
+        long seen = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&]() { return stopping || generation != seen; });
+                if (stopping) {
+                    return;
+                }
+
+                seen = generation;
+            }
+
+            drain();
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--busy == 0) {
+                finished.notify_one();
+            }
+        }
+    }
+};
+
+struct Machine {
+    std::vector<int> weekDayPatterns;
+    std::vector<int> weekEndPatterns;
+
+    std::vector<long> weekDayPatternCosts;
+    std::vector<long> weekEndPatternCosts;
+
+    std::vector<double> loads;
+    std::vector<int> noDelays;
+};
+
+// Working hours per week of a machine-week
+int getCapacity(int weekDayPattern, int weekEndPattern) {
+    return 5 * PATTERN_HOURS[weekDayPattern - 1] + 2 * PATTERN_HOURS[weekEndPattern - 1];
+}
+
+// Bounds on the working hours a machine-week has to absorb under the current patterns
+struct DemandBounds {
+    double low = 0.0;
+    double high = INFINITY;
+    bool probed = false;
+};
+
+struct State {
+    std::vector<Machine> machines;
+
+    long score = 0;
+    int noViolations = 0;
+    int noDelays = 0;
+};
+
+enum class OptimizationPartType {
+    WEEK_DAY,
+    WEEK_END
+};
+
+struct OptimizationPart {
+    int machine;
+    int week;
+    OptimizationPartType type;
+    int from;
+    int to;
+    long costImprovement;
+
+    static OptimizationPart weekDay(const State &state, int machine, int week, int newPattern) {
+        return {
+                machine,
+                week,
+                OptimizationPartType::WEEK_DAY,
+                state.machines[machine].weekDayPatterns[week],
+                newPattern,
+                state.machines[machine].weekDayPatternCosts[state.machines[machine].weekDayPatterns[week] - 1]
+                - state.machines[machine].weekDayPatternCosts[newPattern - 1]
+        };
+    }
+
+    static OptimizationPart weekEnd(const State &state, int machine, int week, int newPattern) {
+        return {
+                machine,
+                week,
+                OptimizationPartType::WEEK_END,
+                state.machines[machine].weekEndPatterns[week],
+                newPattern,
+                state.machines[machine].weekEndPatternCosts[state.machines[machine].weekEndPatterns[week] - 1]
+                - state.machines[machine].weekEndPatternCosts[newPattern - 1]
+        };
+    }
+
+    void apply(State &state) const {
+        if (type == OptimizationPartType::WEEK_DAY) {
+            state.machines[machine].weekDayPatterns[week] = std::clamp(1, to, 9);
+        } else {
+            state.machines[machine].weekEndPatterns[week] = std::clamp(1, to, 9);
+        }
+    }
+
+    void undo(State &state) const {
+        if (type == OptimizationPartType::WEEK_DAY) {
+            state.machines[machine].weekDayPatterns[week] = std::clamp(1, from, 9);
+        } else {
+            state.machines[machine].weekEndPatterns[week] = std::clamp(1, from, 9);
+        }
+    }
+};
+
+struct Optimization {
+    std::string id;
+    std::string name;
+    long costImprovement;
+    std::vector<OptimizationPart> parts;
+
+    explicit Optimization(std::string name, std::vector<OptimizationPart> parts)
+            : name(std::move(name)), parts(std::move(parts)) {
+        std::stringstream idStream;
+        costImprovement = 0.0;
+
+        for (int i = 0; i < this->parts.size(); i++) {
+            const auto &part = this->parts[i];
+
+            idStream << part.machine
+                     << "-" << part.week
+                     << "-" << (int) part.type
+                     << "-" << part.from
+                     << "-" << part.to;
+
+            costImprovement += part.costImprovement;
+
+            if (i != this->parts.size() - 1) {
+                idStream << "_";
+            }
+        }
+
+        id = idStream.str();
+    }
+
+    void apply(State &state) const {
+        for (const auto &part : parts) {
+            part.apply(state);
+        }
+    }
+
+    void undo(State &state) const {
+        // Parts may change the same pattern several times, so undo them in reverse
+        for (auto it = parts.rbegin(); it != parts.rend(); it++) {
+            it->undo(state);
+        }
+    }
+};
+
+enum class OptimizationCategory {
+    REDUCE_GLOBAL,
+    REDUCE_GLOBAL_MACHINE,
+    REDUCE_GLOBAL_HALF,
+    IMPROVE_SPLIT,
+    CREATE_SPLIT,
+    SHUTDOWN
+};
+
+OptimizationCategory getCategory(const std::string &name) {
+    if (name.rfind("ReduceGlobalWeek", 0) == 0) {
+        return OptimizationCategory::REDUCE_GLOBAL_HALF;
+    } else if (name == "ReduceGlobal") {
+        return OptimizationCategory::REDUCE_GLOBAL;
+    } else if (name.rfind("ReduceGlobal", 0) == 0) {
+        return OptimizationCategory::REDUCE_GLOBAL_MACHINE;
+    } else if (name.rfind("ImproveSplit", 0) == 0) {
+        return OptimizationCategory::IMPROVE_SPLIT;
+    } else if (name.rfind("CreateSplit", 0) == 0) {
+        return OptimizationCategory::CREATE_SPLIT;
+    } else {
+        return OptimizationCategory::SHUTDOWN;
+    }
+}
+
+enum class InitialMode {
+    UNKNOWN,
+    UP,
+    DOWN,
+    DONE
+};
+
+struct Solver {
+    int noWeeks;
+    int noMachines;
+    int maxChanges;
+    int noInteractions;
+
+    int currentInteraction = 0;
+
+    State bestState;
+
+    std::optional<Optimization> previousOptimization;
+    std::optional<Optimization> capacityRepair;
+    std::unordered_set<std::string> badOptimizations;
+
+    InitialMode initialMode = InitialMode::UNKNOWN;
+    bool isRepairing = false;
+    bool reduceGlobalFailed = false;
+
+    // Set by the trainer, the model to rank with and the chance of trying a random optimization instead
+    std::array<double, FEATURE_COUNT> modelWeights = MODEL_WEIGHTS;
+    double explorationRate = 0.0;
+    std::mt19937 random;
+
+    // Features of the optimization selected by the last refine() call, read by the trainer
+    std::optional<std::vector<double>> selectedFeatures;
+
+    // Outcomes of the tried optimizations per category, the first reply after trying one decides
+    std::array<int, 6> categoryTrials{};
+    std::array<int, 6> categorySuccesses{};
+
+    // [machine * noWeeks + week]
+    std::vector<DemandBounds> demand;
+
+    // The state to continue from while a probe is being answered
+    std::optional<State> preProbeState;
+
+    // Runs the rollouts of plan(), one task per first optimization
+    mutable WorkerPool workers{std::clamp((int) std::thread::hardware_concurrency(), 1, PLAN_FIRST_MOVES)};
+
+    Solver(int noWeeks, int noMachines, int maxChanges, int noInteractions)
+            : noWeeks(noWeeks),
+              noMachines(noMachines),
+              maxChanges(maxChanges),
+              noInteractions(noInteractions) {}
+
+    void setInitialPatterns(State &state) const {
+        for (int i = 0; i < noMachines; i++) {
+            auto &machine = state.machines[i];
+
+            for (int j = 0; j < noWeeks; j++) {
+                machine.weekDayPatterns[j] = 7;
+                machine.weekEndPatterns[j] = 7;
+            }
+        }
+    }
+
+    void refine(State &state) {
+        ALLOCATION_PHASE("refine");
+
+        observeDemand(state);
+
+        if (preProbeState.has_value()) {
+            log << "Probe answered" << std::endl;
+
+            state = *preProbeState;
+            preProbeState.reset();
+        }
+
+        if (previousOptimization.has_value() && !capacityRepair.has_value() && !isRepairing) {
+            int category = (int) getCategory(previousOptimization->name);
+            categoryTrials[category]++;
+            categorySuccesses[category] += state.score > bestState.score;
+        }
+
+        selectedFeatures.reset();
+
+        if (state.score > bestState.score) {
+            bestState = state;
+        }
+
+        if (initialMode == InitialMode::UNKNOWN) {
+            initialMode = state.score == 0 ? InitialMode::UP : InitialMode::DOWN;
+        }
+
+        if (initialMode == InitialMode::UP) {
+            if (state.score > 0) {
+                initialMode = InitialMode::DONE;
+            } else {
+                for (int i = 0; i < noMachines; i++) {
+                    auto &machine = state.machines[i];
+
+                    for (int j = 0; j < noWeeks; j++) {
+                        machine.weekDayPatterns[j]++;
+                        machine.weekEndPatterns[j]++;
+                    }
+                }
+
+                return;
+            }
+        }
+
+        if (initialMode == InitialMode::DOWN) {
+            if (state.score == 0) {
+                initialMode = InitialMode::DONE;
+
+                for (int i = 0; i < noMachines; i++) {
+                    auto &machine = state.machines[i];
+
+                    for (int j = 0; j < noWeeks; j++) {
+                        machine.weekDayPatterns[j]++;
+                        machine.weekEndPatterns[j]++;
+                    }
+                }
+            } else {
+                for (int i = 0; i < noMachines; i++) {
+                    auto &machine = state.machines[i];
+
+                    for (int j = 0; j < noWeeks; j++) {
+                        machine.weekDayPatterns[j]--;
+                        machine.weekEndPatterns[j]--;
+                    }
+                }
+
+                return;
+            }
+        }
+
+        if (previousOptimization.has_value() && state.score < bestState.score) {
+            bool capacityRepairFailed = false;
+            if (capacityRepair.has_value()) {
+                log << "Capacity repair of " << previousOptimization->name << " does not work" << std::endl;
+
+                capacityRepair->undo(state);
+                capacityRepair.reset();
+                capacityRepairFailed = true;
+            }
+
+            if (!capacityRepairFailed
+                && state.noViolations == 0
+                && state.noDelays > 0
+                && (state.noDelays <= 5 || previousOptimization->costImprovement >= 100'000'000)
+                && currentInteraction != noInteractions) {
+                capacityRepair = generateCapacityRepair(state);
+
+                if (capacityRepair.has_value()) {
+                    log << "Optimization " << previousOptimization->name << " does not work, trying capacity repair"
+                        << " (cost improvement: " << capacityRepair->costImprovement << ")" << std::endl;
+
+                    capacityRepair->apply(state);
+                    return;
+                }
+            }
+
+            State statePriorToRepairs = state;
+
+            if (!isRepairing
+                && !capacityRepairFailed
+                && state.noDelays > 0
+                && (state.noDelays <= 5 || previousOptimization->costImprovement >= 100'000'000)
+                && currentInteraction != noInteractions) {
+                log << "Optimization " << previousOptimization->name << " does not work, trying to repair" << std::endl;
+
+                isRepairing = true;
+                bool canRepair = true;
+                bool madeChanges = false;
+
+                for (int i = 0; i < noMachines; i++) {
+                    auto &machine = state.machines[i];
+
+                    for (int j = 0; j < noWeeks; j++) {
+                        if (machine.noDelays[j] == 0) {
+                            continue;
+                        }
+
+                        for (const auto &part : previousOptimization->parts) {
+                            if (part.machine == i && part.week == j) {
+                                part.undo(state);
+                                madeChanges = true;
+                            }
+                        }
+                    }
+
+                    canRepair = canRepair && getRemainingChanges(machine) >= 1;
+                }
+
+                canRepair = canRepair && madeChanges;
+
+                if (canRepair) {
+                    return;
+                }
+            }
+
+            if (isRepairing) {
+                state = statePriorToRepairs;
+                isRepairing = false;
+            }
+
+            log << "Optimization " << previousOptimization->name << " does not work, reverting" << std::endl;
+
+            if (currentInteraction == noInteractions) {
+                state = bestState;
+            } else {
+                previousOptimization->undo(state);
+            }
+
+            badOptimizations.insert(previousOptimization->id);
+
+            if (previousOptimization->name == "ReduceGlobal") {
+                reduceGlobalFailed = true;
+            }
+        } else if (previousOptimization.has_value()) {
+            log << "Optimization " << previousOptimization->name << " works"
+                << (capacityRepair.has_value() ? " after capacity repair" : "") << std::endl;
+        }
+
+        capacityRepair.reset();
+
+        State estimatedState = getEstimatedState(state);
+        auto optimizations = generateOptimizations(estimatedState);
+
+        std::vector<const Optimization *> candidates;
+        for (const auto &optimization : optimizations) {
+            if (optimization.costImprovement > 0
+                && badOptimizations.find(optimization.id) == badOptimizations.end()) {
+                candidates.push_back(&optimization);
+            }
+        }
+
+        std::optional<Optimization> bestOptimization;
+        std::vector<double> bestFeatures;
+        double bestProbability = 0.0;
+
+        if (!candidates.empty()
+            && explorationRate > 0
+            && std::uniform_real_distribution<double>(0.0, 1.0)(random) < explorationRate) {
+            const auto *candidate = candidates[std::uniform_int_distribution<int>(0, candidates.size() - 1)(random)];
+
+            bestOptimization = *candidate;
+            bestFeatures = getFeatures(estimatedState, *candidate);
+            bestProbability = getSuccessProbability(bestFeatures);
+        } else if (!candidates.empty()) {
+            std::vector<double> probabilities;
+            std::vector<double> priorities;
+            probabilities.reserve(candidates.size());
+            priorities.reserve(candidates.size());
+
+            for (const auto *candidate : candidates) {
+                double probability = getObservedProbability(*candidate,
+                                                            getSuccessProbability(getFeatures(estimatedState, *candidate)));
+                probabilities.push_back(probability);
+                priorities.push_back(getPriority(probability, (double) candidate->costImprovement));
+            }
+
+            // Candidates by descending priority, stable so ties keep the generation order
+            std::vector<int> order(candidates.size());
+            for (int i = 0; i < order.size(); i++) {
+                order[i] = i;
+            }
+
+            std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+                return priorities[a] > priorities[b];
+            });
+
+            order.resize(std::min((int) order.size(), PLAN_POOL_SIZE));
+
+            if (shouldProbe(state, candidates, probabilities, order)) {
+                startProbe(state);
+                previousOptimization.reset();
+                return;
+            }
+
+            int selected = order[plan(candidates, probabilities, order)];
+
+            bestOptimization = *candidates[selected];
+            bestFeatures = getFeatures(estimatedState, *candidates[selected]);
+            bestProbability = probabilities[selected];
+        }
+
+        if (bestOptimization.has_value()) {
+            log << "Trying optimization " << bestOptimization->name
+                << " (cost improvement: " << bestOptimization->costImprovement
+                << ", success probability: " << bestProbability << ")"
+                << std::endl;
+
+            bestOptimization->apply(state);
+            selectedFeatures = bestFeatures;
+        } else {
+            log << "No optimizations to try" << std::endl;
+        }
+
+        previousOptimization = bestOptimization;
+    }
+
+    [[nodiscard]] std::vector<Optimization> generateOptimizations(const State &state) const {
+        ALLOCATION_PHASE("generateOptimizations");
+
+        std::vector<Optimization> optimizations;
+
+        std::vector<OptimizationPart> reduceGlobalParts;
+
+        for (int i = 0; i < noMachines; i++) {
+            auto &machine = state.machines[i];
+
+            auto [lastOperatingWeekDay, lastOperatingWeekEnd] = getLastOperatingWeeks(machine);
+
+            bool canReduceGlobalWeekDay = lastOperatingWeekDay != -1;
+            bool canReduceGlobalWeekEnd = lastOperatingWeekEnd != -1;
+
+            double weekDayLoadSum = 0.0;
+            double weekEndLoadSum = 0.0;
+
+            for (int j = 0; j <= lastOperatingWeekDay; j++) {
+                weekDayLoadSum += machine.loads[j];
+
+                if (machine.weekDayPatterns[j] != machine.weekDayPatterns[0]) {
+                    canReduceGlobalWeekDay = false;
+                    break;
+                }
+            }
+
+            for (int j = 0; j <= lastOperatingWeekEnd; j++) {
+                weekEndLoadSum += machine.loads[j];
+
+                if (machine.weekEndPatterns[j] != machine.weekEndPatterns[0]) {
+                    canReduceGlobalWeekEnd = false;
+                    break;
+                }
+            }
+
+            if (noInteractions != 300 && (weekDayLoadSum / ((double) (lastOperatingWeekDay + 1))) > 0.6) {
+                canReduceGlobalWeekDay = false;
+            }
+
+            if (noInteractions != 300 && (weekEndLoadSum / ((double) (lastOperatingWeekEnd + 1))) > 0.6) {
+                canReduceGlobalWeekEnd = false;
+            }
+
+            if (canReduceGlobalWeekDay && canReduceGlobalWeekEnd) {
+                std::vector<OptimizationPart> parts;
+
+                for (int j = 0; j <= std::min(lastOperatingWeekDay, lastOperatingWeekEnd); j++) {
+                    parts.push_back(OptimizationPart::weekDay(state, i, j, machine.weekDayPatterns[j] - 1));
+                    parts.push_back(OptimizationPart::weekEnd(state, i, j, machine.weekEndPatterns[j] - 1));
+                    reduceGlobalParts.push_back(OptimizationPart::weekDay(state, i, j, machine.weekDayPatterns[j] - 1));
+                    reduceGlobalParts.push_back(OptimizationPart::weekEnd(state, i, j, machine.weekEndPatterns[j] - 1));
+                }
+
+                optimizations.emplace_back("ReduceGlobal" + std::to_string(i), parts);
+            }
+
+            if (canReduceGlobalWeekDay) {
+                std::vector<OptimizationPart> parts;
+
+                for (int j = 0; j <= lastOperatingWeekDay; j++) {
+                    parts.push_back(OptimizationPart::weekDay(state, i, j, machine.weekDayPatterns[j] - 1));
+                }
+
+                optimizations.emplace_back("ReduceGlobalWeekDay" + std::to_string(i), parts);
+            }
+
+            if (canReduceGlobalWeekEnd) {
+                std::vector<OptimizationPart> parts;
+
+                for (int j = 0; j <= lastOperatingWeekEnd; j++) {
+                    parts.push_back(OptimizationPart::weekEnd(state, i, j, machine.weekEndPatterns[j] - 1));
+                }
+
+                optimizations.emplace_back("ReduceGlobalWeekEnd" + std::to_string(i), parts);
+            }
+
+            double createSplitThreshold = 0.4;
+            double improveSplitThreshold = 0.9;
+
+            int weekDayChanges = getChanges(machine.weekDayPatterns);
+            int weekEndChanges = getChanges(machine.weekEndPatterns);
+
+            if (lastOperatingWeekDay != -1) {
+                std::vector<std::pair<int, int>> existingSplits;
+                existingSplits.emplace_back(0, 1);
+                for (int j = 1; j <= lastOperatingWeekDay; j++) {
+                    if (machine.weekDayPatterns[j] != machine.weekDayPatterns[j - 1]) {
+                        existingSplits.emplace_back(j, 1);
+                    } else {
+                        existingSplits[existingSplits.size() - 1].second++;
+                    }
+                }
+
+                std::reverse(existingSplits.begin(), existingSplits.end());
+
+                for (const auto &[start, size] : existingSplits) {
+                    bool canImprove = true;
+                    double loadSum = 0.0;
+                    for (int j = start; j < start + size; j++) {
+                        loadSum += machine.loads[j];
+                        if (machine.weekDayPatterns[j] == 1) {
+                            canImprove = false;
+                            break;
+                        }
+                    }
+
+                    if ((loadSum / ((double) size)) > improveSplitThreshold) {
+                        canImprove = false;
+                    }
+
+                    if (canImprove) {
+                        std::vector<OptimizationPart> parts;
+
+                        for (int j = start; j < start + size; j++) {
+                            parts.push_back(OptimizationPart::weekDay(state, i, j, machine.weekDayPatterns[j] - 1));
+                        }
+
+                        optimizations.emplace_back("ImproveSplitWeekDay" + std::to_string(i), parts);
+                        break;
+                    }
+                }
+
+                std::vector<OptimizationPart> parts;
+                std::vector<int> newPatterns = machine.weekDayPatterns;
+
+                double loadSum = 0.0;
+
+                for (int j = lastOperatingWeekDay; j >= 0; j--) {
+                    loadSum += machine.loads[j];
+                    if ((loadSum / (lastOperatingWeekDay - j + 1)) > createSplitThreshold) {
+                        break;
+                    }
+
+                    parts.push_back(OptimizationPart::weekDay(state, i, j, machine.weekDayPatterns[j] - 1));
+                    newPatterns[j]--;
+                }
+
+                int newChanges = getChanges(newPatterns);
+                int newRemainingChanges = maxChanges - newChanges - weekEndChanges;
+
+                if (!parts.empty() && newRemainingChanges >= 0) {
+                    optimizations.emplace_back("CreateSplitWeekDay" + std::to_string(i), parts);
+                }
+            }
+
+            if (lastOperatingWeekEnd != -1) {
+                std::vector<std::pair<int, int>> existingSplits;
+                existingSplits.emplace_back(0, 1);
+                for (int j = 1; j <= lastOperatingWeekEnd; j++) {
+                    if (machine.weekEndPatterns[j] != machine.weekEndPatterns[j - 1]) {
+                        existingSplits.emplace_back(j, 1);
+                    } else {
+                        existingSplits[existingSplits.size() - 1].second++;
+                    }
+                }
+
+                std::reverse(existingSplits.begin(), existingSplits.end());
+
+                for (const auto &[start, size] : existingSplits) {
+                    bool canImprove = true;
+                    double loadSum = 0.0;
+                    for (int j = start; j < start + size; j++) {
+                        loadSum += machine.loads[j];
+                        if (machine.weekEndPatterns[j] == 1) {
+                            canImprove = false;
+                            break;
+                        }
+                    }
+
+                    if ((loadSum / ((double) size)) > improveSplitThreshold) {
+                        canImprove = false;
+                    }
+
+                    if (canImprove) {
+                        std::vector<OptimizationPart> parts;
+
+                        for (int j = start; j < start + size; j++) {
+                            parts.push_back(OptimizationPart::weekEnd(state, i, j, machine.weekEndPatterns[j] - 1));
+                        }
+
+                        optimizations.emplace_back("ImproveSplitWeekEnd" + std::to_string(i), parts);
+                        break;
+                    }
+                }
+
+                std::vector<OptimizationPart> parts;
+                std::vector<int> newPatterns = machine.weekEndPatterns;
+
+                double loadSum = 0.0;
+
+                for (int j = lastOperatingWeekEnd; j >= 0; j--) {
+                    loadSum += machine.loads[j];
+                    if ((loadSum / (lastOperatingWeekDay - j + 1)) > createSplitThreshold) {
+                        break;
+                    }
+
+                    parts.push_back(OptimizationPart::weekEnd(state, i, j, machine.weekEndPatterns[j] - 1));
+                    newPatterns[j]--;
+                }
+
+                int newChanges = getChanges(newPatterns);
+                int newRemainingChanges = maxChanges - weekDayChanges - newChanges;
+
+                if (!parts.empty() && newRemainingChanges >= 0) {
+                    optimizations.emplace_back("CreateSplitWeekEnd" + std::to_string(i), parts);
+                }
+            }
+        }
+
+        if (noInteractions != 300 && !reduceGlobalFailed) {
+            optimizations.emplace_back("ReduceGlobal", reduceGlobalParts);
+        }
+
+        if (currentInteraction == noInteractions) {
+            std::vector<OptimizationPart> parts;
+
+            for (int i = 0; i < noMachines; i++) {
+                auto &machine = state.machines[i];
+
+                auto [lastOperatingWeekDay, lastOperatingWeekEnd] = getLastOperatingWeeks(machine);
+
+                int remainingChanges = getRemainingChanges(machine);
+                if (remainingChanges == 0) {
+                    continue;
+                }
+
+                std::vector<OptimizationPart> partsAll;
+                std::vector<OptimizationPart> partsWeekDay;
+                std::vector<OptimizationPart> partsWeekEnd;
+
+                for (int j = std::max(lastOperatingWeekDay, lastOperatingWeekEnd); j >= 0; j--) {
+                    if (machine.loads[j] > 0) {
+                        break;
+                    }
+
+                    partsAll.push_back(OptimizationPart::weekDay(state, i, j, 1));
+                    partsAll.push_back(OptimizationPart::weekEnd(state, i, j, 1));
+                    partsWeekDay.push_back(OptimizationPart::weekDay(state, i, j, 1));
+                    partsWeekEnd.push_back(OptimizationPart::weekEnd(state, i, j, 1));
+                }
+
+                if (remainingChanges == 1) {
+                    if (Optimization("", partsWeekDay).costImprovement
+                        > Optimization("", partsWeekEnd).costImprovement) {
+                        parts.insert(parts.end(), partsWeekDay.begin(), partsWeekDay.end());
+                    } else {
+                        parts.insert(parts.end(), partsWeekEnd.begin(), partsWeekEnd.end());
+                    }
+                } else {
+                    parts.insert(parts.end(), partsAll.begin(), partsAll.end());
+                }
+            }
+
+            optimizations.emplace_back("Shutdown", parts);
+        }
+
+        return optimizations;
+    }
+
+    // Cheapest pattern upgrades on the weeks with delays and the weeks before them that give back the hours the
+    // previous optimization took from them, or a single upgrade if the delay comes from another machine
+    [[nodiscard]] std::optional<Optimization> generateCapacityRepair(const State &state) const {
+        ALLOCATION_PHASE("generateCapacityRepair");
+
+        State repairedState = state;
+        std::vector<OptimizationPart> parts;
+
+        for (int i = 0; i < noMachines; i++) {
+            auto &machine = repairedState.machines[i];
+
+            std::vector<int> removedHours(noWeeks, 0);
+            for (const auto &part : previousOptimization->parts) {
+                if (part.machine == i) {
+                    int days = part.type == OptimizationPartType::WEEK_DAY ? 5 : 2;
+                    removedHours[part.week] += days * (PATTERN_HOURS[part.from - 1] - PATTERN_HOURS[part.to - 1]);
+                }
+            }
+
+            for (int j = 0; j < noWeeks; j++) {
+                if (machine.noDelays[j] == 0) {
+                    continue;
+                }
+
+                int requiredHours = std::max(1, removedHours[j] + (j > 0 ? removedHours[j - 1] : 0));
+                int addedHours = 0;
+
+                while (addedHours < requiredHours) {
+                    std::optional<OptimizationPart> bestPart;
+                    int bestHours = 0;
+                    double bestCostPerHour = 0.0;
+
+                    for (int week = std::max(0, j - 1); week <= j; week++) {
+                        for (auto type : {OptimizationPartType::WEEK_DAY, OptimizationPartType::WEEK_END}) {
+                            bool isWeekDay = type == OptimizationPartType::WEEK_DAY;
+                            auto &patterns = isWeekDay ? machine.weekDayPatterns : machine.weekEndPatterns;
+
+                            int pattern = patterns[week];
+                            if (pattern == 9) {
+                                continue;
+                            }
+
+                            auto part = isWeekDay
+                                        ? OptimizationPart::weekDay(repairedState, i, week, pattern + 1)
+                                        : OptimizationPart::weekEnd(repairedState, i, week, pattern + 1);
+
+                            part.apply(repairedState);
+                            bool withinChanges = getRemainingChanges(machine) >= 0;
+                            part.undo(repairedState);
+
+                            if (!withinChanges) {
+                                continue;
+                            }
+
+                            int hours = (isWeekDay ? 5 : 2) * (PATTERN_HOURS[pattern] - PATTERN_HOURS[pattern - 1]);
+                            double costPerHour = (double) -part.costImprovement / (double) hours;
+
+                            if (!bestPart.has_value() || costPerHour < bestCostPerHour) {
+                                bestPart = part;
+                                bestHours = hours;
+                                bestCostPerHour = costPerHour;
+                            }
+                        }
+                    }
+
+                    if (!bestPart.has_value()) {
+                        return std::nullopt;
+                    }
+
+                    bestPart->apply(repairedState);
+                    parts.push_back(*bestPart);
+                    addedHours += bestHours;
+                }
+            }
+        }
+
+        if (parts.empty()) {
+            return std::nullopt;
+        }
+
+        Optimization repair("CapacityRepair", parts);
+
+        // A repair that gives back most of the savings is not worth an interaction, reverting is cheaper
+        if (previousOptimization->costImprovement + repair.costImprovement < previousOptimization->costImprovement / 2) {
+            return std::nullopt;
+        }
+
+        return repair;
+    }
+
+    [[nodiscard]] std::vector<double> getFeatures(const State &state, const Optimization &optimization) const {
+        std::vector<double> features(FEATURE_COUNT, 0.0);
+
+        features[0] = 1.0;
+        features[1 + (int) getCategory(optimization.name)] = 1.0;
+
+        double loadSum = 0.0;
+        double maxLoad = 0.0;
+        double weekSum = 0.0;
+        int minRemainingChanges = maxChanges;
+
+        for (const auto &part : optimization.parts) {
+            const auto &machine = state.machines[part.machine];
+            double load = machine.loads.empty() ? 0.0 : machine.loads[part.week];
+
+            loadSum += load;
+            maxLoad = std::max(maxLoad, load);
+            weekSum += (double) part.week / (double) noWeeks;
+            minRemainingChanges = std::min(minRemainingChanges, getRemainingChanges(machine));
+        }
+
+        double noParts = std::max(1.0, (double) optimization.parts.size());
+
+        features[7] = loadSum / noParts;
+        features[8] = maxLoad;
+        features[9] = weekSum / noParts;
+        features[10] = (double) minRemainingChanges / (double) std::max(1, maxChanges);
+        features[11] = std::log10(1.0 + (double) std::max(0L, optimization.costImprovement)) / 10.0;
+        features[12] = (double) currentInteraction / (double) noInteractions;
+        features[13] = (double) optimization.parts.size() / (double) (2 * noWeeks * noMachines);
+
+        return features;
+    }
+
+    [[nodiscard]] double getSuccessProbability(const std::vector<double> &features) const {
+        double z = 0.0;
+        for (int i = 0; i < FEATURE_COUNT; i++) {
+            z += modelWeights[i] * features[i];
+        }
+
+        return 1.0 / (1.0 + std::exp(-z));
+    }
+
+    void observeDemand(const State &state) {
+        demand.resize(noMachines * noWeeks);
+
+        for (int i = 0; i < noMachines; i++) {
+            const auto &machine = state.machines[i];
+
+            for (int j = 0; j < noWeeks; j++) {
+                auto &bounds = demand[i * noWeeks + j];
+                int capacity = getCapacity(machine.weekDayPatterns[j], machine.weekEndPatterns[j]);
+
+                if (capacity == 0) {
+                    continue;
+                }
+
+                if (machine.loads[j] < SATURATED_LOAD) {
+                    bounds.low = bounds.high = machine.loads[j] * capacity;
+                } else {
+                    // a demand measured at a higher capacity still holds if it exceeds this one, and so does a lower
+                    // bound from an earlier saturated week
+                    if (bounds.high < capacity) {
+                        bounds.high = INFINITY;
+                    }
+                    bounds.low = std::max(bounds.low, bounds.high == INFINITY ? (double) capacity : bounds.high);
+                }
+            }
+        }
+    }
+
+    [[nodiscard]] bool isUnknownSaturated(const State &state, int machine, int week) const {
+        const auto &bounds = demand[machine * noWeeks + week];
+        return state.machines[machine].loads[week] >= SATURATED_LOAD
+               && bounds.high == INFINITY
+               && !bounds.probed
+               && state.machines[machine].weekDayPatterns[week] < 9;
+    }
+
+    // The state with the loads of saturated weeks replaced by demand / capacity where the demand has been measured
+    [[nodiscard]] State getEstimatedState(const State &state) const {
+        State estimatedState = state;
+
+        for (int i = 0; i < noMachines; i++) {
+            auto &machine = estimatedState.machines[i];
+
+            for (int j = 0; j < noWeeks; j++) {
+                const auto &bounds = demand[i * noWeeks + j];
+                int capacity = getCapacity(machine.weekDayPatterns[j], machine.weekEndPatterns[j]);
+
+                if (capacity > 0 && machine.loads[j] >= SATURATED_LOAD && bounds.high != INFINITY) {
+                    machine.loads[j] = bounds.high / capacity;
+                }
+            }
+        }
+
+        return estimatedState;
+    }
+
+    // A probe costs an interaction, which is worth about as much as the best optimization at the moment. It pays off if
+    // it avoids more than one failed optimization among the next ones. state is the one startProbe() would probe.
+    [[nodiscard]] bool shouldProbe(const State &state,
+                                   const std::vector<const Optimization *> &candidates,
+                                   const std::vector<double> &probabilities,
+                                   const std::vector<int> &pool) const {
+        if (currentInteraction >= noInteractions - 1) {
+            return false;
+        }
+
+        double avoidableFailures = 0.0;
+        for (int i = 0; i < std::min((int) pool.size(), PROBE_HORIZON); i++) {
+            const auto *candidate = candidates[pool[i]];
+
+            bool touchesUnknown = false;
+            for (const auto &part : candidate->parts) {
+                if (isUnknownSaturated(state, part.machine, part.week)) {
+                    touchesUnknown = true;
+                    break;
+                }
+            }
+
+            if (touchesUnknown) {
+                avoidableFailures += (1.0 - probabilities[pool[i]]) * PROBE_INFORMATIVENESS;
+            }
+        }
+
+        return avoidableFailures > PROBE_THRESHOLD;
+    }
+
+    void startProbe(State &state) {
+        preProbeState = state;
+
+        int probedWeeks = 0;
+        for (int i = 0; i < noMachines; i++) {
+            auto &machine = state.machines[i];
+
+            for (int j = 0; j < noWeeks; j++) {
+                if (isUnknownSaturated(*preProbeState, i, j)) {
+                    machine.weekDayPatterns[j] = std::min(9, machine.weekDayPatterns[j] + PROBE_PATTERN_STEPS);
+                    demand[i * noWeeks + j].probed = true;
+                    probedWeeks++;
+                }
+            }
+        }
+
+        log << "Probing the demand of " << probedWeeks << " saturated weeks" << std::endl;
+    }
+
+    [[nodiscard]] static double getPriority(double probability, double costImprovement) {
+        return std::pow(probability, MODEL_EXPONENT) * costImprovement;
+    }
+
+    // Blends the model's probability with the success rate of the category observed in this run
+    [[nodiscard]] double getObservedProbability(const Optimization &optimization, double probability) const {
+        int category = (int) getCategory(optimization.name);
+        return (PRIOR_TRIALS * probability + categorySuccesses[category]) / (PRIOR_TRIALS + categoryTrials[category]);
+    }
+
+    // Picks the optimization to try next from the pool (candidate indices by descending priority), returns its index
+    // in the pool. Every remaining interaction can try one optimization, so an optimization that fails early costs an
+    // interaction that could have tried another one. For each of the first PLAN_FIRST_MOVES optimizations of the pool,
+    // rollouts simulate the remaining interactions starting with it: outcomes are drawn from the success
+    // probabilities, a success removes the optimizations that overlap it and a failure makes them less likely to
+    // work, and the following optimizations are picked by priority. The first optimization with the highest mean
+    // improvement is tried if it beats the one with the highest priority by PLAN_MARGIN. The rollouts of different
+    // first optimizations run on the worker pool, with random seeds that only depend on the interaction and the
+    // optimization, so the result does not depend on the number of threads.
+    [[nodiscard]] int plan(const std::vector<const Optimization *> &candidates,
+                           const std::vector<double> &probabilities,
+                           const std::vector<int> &pool) const {
+        ALLOCATION_PHASE("plan");
+
+        int poolSize = pool.size();
+        int firstMoves = std::min(poolSize, PLAN_FIRST_MOVES);
+        int budget = noInteractions - currentInteraction + 1;
+
+        if (firstMoves <= 1 || budget <= 1) {
+            return 0;
+        }
+
+        // Optimizations of the pool that change a pattern of the same machine-week
+        std::vector<std::vector<int>> cellCandidates(noMachines * noWeeks);
+        for (int i = 0; i < poolSize; i++) {
+            for (const auto &part : candidates[pool[i]]->parts) {
+                auto &cell = cellCandidates[part.machine * noWeeks + part.week];
+                if (cell.empty() || cell.back() != i) {
+                    cell.push_back(i);
+                }
+            }
+        }
+
+        std::vector<std::vector<int>> overlaps(poolSize);
+        std::vector<int> seen(poolSize, -1);
+        for (int i = 0; i < poolSize; i++) {
+            seen[i] = i;
+
+            for (const auto &part : candidates[pool[i]]->parts) {
+                for (int j : cellCandidates[part.machine * noWeeks + part.week]) {
+                    if (seen[j] != i) {
+                        seen[j] = i;
+                        overlaps[i].push_back(j);
+                    }
+                }
+            }
+        }
+
+        std::vector<double> poolProbabilities(poolSize);
+        std::vector<double> poolImprovements(poolSize);
+        std::vector<double> poolPriorities(poolSize);
+        for (int i = 0; i < poolSize; i++) {
+            poolProbabilities[i] = probabilities[pool[i]];
+            poolImprovements[i] = (double) candidates[pool[i]]->costImprovement;
+            poolPriorities[i] = getPriority(poolProbabilities[i], poolImprovements[i]);
+        }
+
+        // The priorities are only recomputed for the probabilities a failure changes
+        auto rollout = [&](int first, std::mt19937 &generator) {
+            std::vector<double> p = poolProbabilities;
+            std::vector<double> priorities = poolPriorities;
+            std::vector<bool> available(poolSize, true);
+            std::uniform_real_distribution<double> distribution(0.0, 1.0);
+
+            double improvement = 0.0;
+            for (int move = first, remaining = budget; move != -1 && remaining > 0; remaining--) {
+                available[move] = false;
+
+                if (distribution(generator) < p[move]) {
+                    improvement += poolImprovements[move];
+
+                    for (int j : overlaps[move]) {
+                        available[j] = false;
+                    }
+                } else {
+                    for (int j : overlaps[move]) {
+                        p[j] *= FAILURE_CORRELATION;
+                        priorities[j] = getPriority(p[j], poolImprovements[j]);
+                    }
+                }
+
+                move = -1;
+                double bestPriority = -1;
+                for (int j = 0; j < poolSize; j++) {
+                    double priority = available[j] ? priorities[j] : -1;
+                    if (priority > bestPriority) {
+                        move = j;
+                        bestPriority = priority;
+                    }
+                }
+            }
+
+            return improvement;
+        };
+
+        std::vector<double> values(firstMoves, 0.0);
+        auto evaluate = [&](int first) {
+            std::mt19937 generator(currentInteraction * PLAN_FIRST_MOVES + first);
+            for (int i = 0; i < PLAN_ROLLOUTS; i++) {
+                values[first] += rollout(first, generator);
+            }
+        };
+
+        workers.run(firstMoves, evaluate);
+
+        int best = 0;
+        for (int i = 1; i < firstMoves; i++) {
+            if (values[i] > values[best] && values[i] > values[0] * (1 + PLAN_MARGIN)) {
+                best = i;
+            }
+        }
+
+        log << "Planned " << candidates[pool[best]]->name << " over " << budget << " interactions"
+            << " (mean improvement: " << values[best] / PLAN_ROLLOUTS
+            << ", priority order: " << values[0] / PLAN_ROLLOUTS << ")" << std::endl;
+
+        return best;
+    }
+
+    [[nodiscard]] std::pair<int, int> getLastOperatingWeeks(const Machine &machine) const {
+        int lastOperatingWeekDay = -1;
+        int lastOperatingWeekEnd = -1;
+
+        for (int i = noWeeks - 1; i >= 0 && (lastOperatingWeekDay == -1 || lastOperatingWeekEnd == -1); i--) {
+            if (lastOperatingWeekDay == -1 && machine.weekDayPatterns[i] != 1) {
+                lastOperatingWeekDay = i;
+            }
+
+            if (lastOperatingWeekEnd == -1 && machine.weekEndPatterns[i] != 1) {
+                lastOperatingWeekEnd = i;
+            }
+        }
+
+        return {lastOperatingWeekDay, lastOperatingWeekEnd};
+    }
+
+    [[nodiscard]] int getRemainingChanges(const Machine &machine) const {
+        return maxChanges - getChanges(machine.weekDayPatterns) - getChanges(machine.weekEndPatterns);
+    }
+
+    [[nodiscard]] int getChanges(const std::vector<int> &patterns) const {
+        int changes = 0;
+
+        for (int i = 0; i < noWeeks - 1; i++) {
+            if (patterns[i] != patterns[i + 1]) {
+                changes++;
+            }
+        }
+
+        return changes;
+    }
+};
+
+#ifndef SOLVER_NO_MAIN
+int main() {
+    int noWeeks, noMachines, maxChanges, noInteractions;
+    std::cin >> noWeeks >> noMachines >> maxChanges >> noInteractions;
+
+    log << "noWeeks = " << noWeeks
+        << ", noMachines = " << noMachines
+        << ", maxChanges = " << maxChanges
+        << ", noInteractions = " << noInteractions
+        << std::endl;
+
+    Solver solver(noWeeks, noMachines, maxChanges, noInteractions);
+
+    State state;
+    state.machines.resize(noMachines);
+
+    for (int i = 0; i < noMachines; i++) {
+        auto &machine = state.machines[i];
+
+        machine.weekDayPatterns.resize(noWeeks);
+        machine.weekEndPatterns.resize(noWeeks);
+
+        machine.weekDayPatternCosts.reserve(noWeeks);
+        machine.weekEndPatternCosts.reserve(noWeeks);
+
+        for (int j = 0; j < 9; j++) {
+            int weekDayCost, weekEndCost;
+            std::cin >> weekDayCost >> weekEndCost;
+
+            machine.weekDayPatternCosts.push_back(weekDayCost);
+            machine.weekEndPatternCosts.push_back(weekEndCost);
+        }
+    }
+
+    log << "\nInteraction 1" << std::endl;
+    solver.currentInteraction = 1;
+    solver.setInitialPatterns(state);
+
+    for (int i = 0; i < noInteractions; i++) {
+        ALLOCATION_PHASE("interaction");
+
+        for (int j = 0; j < noMachines; j++) {
+            auto &machine = state.machines[j];
+
+            for (int k = 0; k < noWeeks; k++) {
+                std::cout << machine.weekDayPatterns[k] << machine.weekEndPatterns[k];
+            }
+
+            std::cout << std::endl;
+        }
+
+        std::cin >> state.score >> state.noViolations >> state.noDelays;
+
+        log << "score = " << state.score
+            << ", noViolations = " << state.noViolations
+            << ", noDelays = " << state.noDelays
+            << std::endl;
+
+        for (int j = 0; j < noMachines; j++) {
+            auto &machine = state.machines[j];
+
+            machine.loads.resize(noWeeks);
+            machine.noDelays.resize(noWeeks);
+
+            for (int k = 0; k < noWeeks; k++) {
+                std::cin >> machine.loads[k] >> machine.noDelays[k];
+            }
+        }
+
+        if (i == noInteractions - 1) {
+            break;
+        }
+
+        log << "\nInteraction " << (i + 2) << std::endl;
+        solver.currentInteraction = i + 2;
+        solver.refine(state);
+    }
+
+    return 0;
+}
+#endif